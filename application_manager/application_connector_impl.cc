@@ -10,16 +10,20 @@
 
 namespace mojo {
 
-ApplicationConnectorImpl::ApplicationConnectorImpl(std::string application_name,
+ApplicationConnectorImpl::ApplicationConnectorImpl(ApplicationId application_id,
                                                    ApplicationManager* manager)
-    : name_(std::move(application_name)), manager_(manager) {}
+    : id_(application_id), manager_(manager) {}
 
 ApplicationConnectorImpl::~ApplicationConnectorImpl() {}
 
+const std::string& ApplicationConnectorImpl::name() const {
+  return manager_->names()->GetName(id_);
+}
+
 void ApplicationConnectorImpl::ConnectToApplication(
     const String& app_name,
     InterfaceRequest<ServiceProvider> services) {
-  manager_->ConnectToApplication(app_name, name_, std::move(services));
+  manager_->ConnectToApplication(app_name, id_, std::move(services));
 }
 
 void ApplicationConnectorImpl::Duplicate(
@@ -6,6 +6,7 @@
 #define MOJO_APPLICATION_MANAGER_APPLICATION_CONNECTOR_IMPL_H_
 
 #include "lib/ftl/macros.h"
+#include "mojo/application_manager/application_names.h"
 #include "mojo/public/cpp/bindings/binding_set.h"
 #include "mojo/public/interfaces/application/application_connector.mojom.h"
 
@@ -15,11 +16,12 @@ class ApplicationManager;
 class ApplicationConnectorImpl : public ApplicationConnector {
  public:
   // The ApplicationManager must remain alive for the lifetime of this object.
-  ApplicationConnectorImpl(std::string application_name,
+  ApplicationConnectorImpl(ApplicationId application_id,
                            ApplicationManager* manager);
   ~ApplicationConnectorImpl();
 
-  const std::string& name() const { return name_; }
+  ApplicationId id() const { return id_; }
+  const std::string& name() const;
 
   void ConnectToApplication(
       const String& app_name,
@@ -29,7 +31,7 @@ class ApplicationConnectorImpl : public ApplicationConnector {
 
  private:
   BindingSet<ApplicationConnector> bindings_;
-  const std::string name_;
+  const ApplicationId id_;
   ApplicationManager* const manager_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationConnectorImpl);
@@ -4,8 +4,15 @@
 
 #include "mojo/application_manager/application_instance.h"
 
+#include <utility>
+
+#include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/logging.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/mtl/tasks/message_loop.h"
 #include "mojo/application_manager/application_launcher.h"
+#include "mojo/application_manager/application_manager.h"
+#include "mojo/application_manager/worker_pool.h"
 #include "mojo/public/interfaces/application/service_provider.mojom.h"
 #include "mojo/public/interfaces/application/shell.mojom.h"
 
@@ -26,19 +33,81 @@ inline void ConnectToService(
                                      interface_request.PassMessagePipe());
 }
 
+// Connections wait for the application to acknowledge its initialize message
+// for at most this long, so that one that never replies (for example, because
+// it does not use the bindings) still gets them.
+constexpr ftl::TimeDelta kReadyTimeout = ftl::TimeDelta::FromSeconds(5);
+
 }  // namespace
 
-ApplicationInstance::ApplicationInstance() {}
+ApplicationInstance::ApplicationInstance()
+    : start_time_(ftl::TimePoint::Now()),
+      last_activity_(start_time_),
+      weak_factory_(this) {
+  timeline_.Mark(LaunchTimeline::Stage::kStarted, start_time_);
+}
 
-ApplicationInstance::~ApplicationInstance() {}
+ApplicationInstance::~ApplicationInstance() {
+  // An application that never became ready, or never got a connection, still
+  // reports how far its launch got.
+  ReportLaunch();
+}
 
 bool ApplicationInstance::Start(ApplicationManager* manager,
                                 const std::string& name) {
   FTL_DCHECK(!application_);
   FTL_DCHECK(!process_.is_valid());
   FTL_DCHECK(!shell_);
-  auto result = mojo::LaunchApplication(manager, name, GetProxy(&application_));
+  return FinishStart(
+      manager,
+      PrepareLaunch(name, manager->launchpad_pool(),
+                    manager->resolved_application_cache(),
+                    GetProxy(&application_)));
+}
+
+void ApplicationInstance::StartOnPool(ApplicationManager* manager,
+                                      const std::string& name,
+                                      WorkerPool* pool,
+                                      std::function<void(bool)> callback) {
+  FTL_DCHECK(!application_);
+  FTL_DCHECK(!process_.is_valid());
+  FTL_DCHECK(!shell_);
+  ftl::RefPtr<ftl::TaskRunner> task_runner =
+      mtl::MessageLoop::GetCurrent()->task_runner();
+  ftl::WeakPtr<ApplicationInstance> weak_this = weak_factory_.GetWeakPtr();
+  LaunchpadPool* launchpads = manager->launchpad_pool();
+  ResolvedApplicationCache* cache = manager->resolved_application_cache();
+  pool->PostTask(ftl::MakeCopyable([
+    manager, name, launchpads, cache, request = GetProxy(&application_),
+    task_runner, weak_this, callback
+  ]() mutable {
+    PreparedLaunch launch =
+        PrepareLaunch(name, launchpads, cache, std::move(request));
+    task_runner->PostTask(ftl::MakeCopyable([
+      manager, launch = std::move(launch), weak_this, callback
+    ]() mutable {
+      bool success = false;
+      if (weak_this)
+        success = weak_this->FinishStart(manager, std::move(launch));
+      callback(success);
+    }));
+  }));
+}
+
+bool ApplicationInstance::FinishStart(ApplicationManager* manager,
+                                      PreparedLaunch launch) {
+  FTL_DCHECK(!process_.is_valid());
+  timeline_.Merge(launch.timeline);
+  std::string content_handler = launch.content_handler;
+  auto result =
+      CompleteLaunch(manager, std::move(launch), &content_handler_lease_);
   process_ = std::move(result.second);
+  if (!content_handler.empty()) {
+    // The same replica that |StartApplicationUsingContentHandler| chose.
+    content_handler_id_ = manager->names()->InternReplica(
+        manager->names()->Intern(content_handler),
+        content_handler_lease_ ? content_handler_lease_->replica() : 0);
+  }
   return result.first;
 }
 
@@ -51,6 +120,96 @@ void ApplicationInstance::Initialize(std::unique_ptr<ShellImpl> shell,
   InterfaceHandle<Shell> shell_handle;
   shell_->Bind(GetProxy(&shell_handle));
   application_->Initialize(std::move(shell_handle), std::move(args), name);
+  timeline_.Mark(LaunchTimeline::Stage::kInitializeSent);
+
+  // The reply comes once the application has processed every message sent
+  // before it, including the initialize message. The callback is owned by
+  // |application_|, so it cannot outlive this object.
+  application_.QueryVersion([this](uint32_t version) { OnReady(); });
+}
+
+void ApplicationInstance::AcceptConnection(
+    const std::string& requestor_name,
+    const std::string& url,
+    InterfaceRequest<ServiceProvider> services) {
+  RecordConnection();
+  DeliverConnection(requestor_name, url, std::move(services));
+}
+
+void ApplicationInstance::DeliverConnection(
+    const std::string& requestor_name,
+    const std::string& url,
+    InterfaceRequest<ServiceProvider> services) {
+  FTL_DCHECK(application_);
+  if (!holding_connections_) {
+    SendConnection(requestor_name, url, std::move(services));
+    return;
+  }
+  if (pending_connections_.empty()) {
+    ftl::WeakPtr<ApplicationInstance> weak_this = weak_factory_.GetWeakPtr();
+    mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+        [weak_this] {
+          if (weak_this)
+            weak_this->OnReadyTimeout();
+        },
+        kReadyTimeout);
+  }
+  pending_connections_.push_back(
+      PendingConnection{requestor_name, url, std::move(services)});
+}
+
+void ApplicationInstance::SendConnection(
+    const std::string& requestor_name,
+    const std::string& url,
+    InterfaceRequest<ServiceProvider> services) {
+  application_->AcceptConnection(requestor_name, url, std::move(services));
+  if (!timeline_.has(LaunchTimeline::Stage::kFirstConnection)) {
+    timeline_.Mark(LaunchTimeline::Stage::kFirstConnection);
+    if (is_ready_)
+      ReportLaunch();
+  }
+}
+
+void ApplicationInstance::SendPendingConnections() {
+  holding_connections_ = false;
+  std::vector<PendingConnection> pending;
+  pending.swap(pending_connections_);
+  for (auto& connection : pending) {
+    SendConnection(connection.requestor_name, connection.url,
+                   std::move(connection.services));
+  }
+}
+
+void ApplicationInstance::OnReady() {
+  if (is_ready_)
+    return;
+  is_ready_ = true;
+  ftl::TimePoint now = ftl::TimePoint::Now();
+  time_to_ready_ = now - start_time_;
+  timeline_.Mark(LaunchTimeline::Stage::kReady, now);
+  FTL_DLOG(INFO) << "Application ready: \"" << name() << "\" after "
+                 << time_to_ready_.ToMilliseconds() << " ms, delivering "
+                 << pending_connections_.size() << " queued connections";
+  SendPendingConnections();
+  if (timeline_.has(LaunchTimeline::Stage::kFirstConnection))
+    ReportLaunch();
+}
+
+void ApplicationInstance::OnReadyTimeout() {
+  if (!holding_connections_)
+    return;
+  FTL_LOG(WARNING) << "Application \"" << name()
+                   << "\" has not acknowledged its initialization; sending "
+                   << pending_connections_.size()
+                   << " queued connections anyway";
+  SendPendingConnections();
+}
+
+void ApplicationInstance::ReportLaunch() {
+  if (launch_reported_ || !launch_finished_callback_)
+    return;
+  launch_reported_ = true;
+  launch_finished_callback_(timeline_);
 }
 
 mojo::ContentHandler* ApplicationInstance::GetOrCreateContentHandler() {
@@ -60,11 +219,26 @@ mojo::ContentHandler* ApplicationInstance::GetOrCreateContentHandler() {
     // We use an empty requestor_url because this request is on behalf of the
     // application manager itself.
     std::string requestor_url;
-    application_->AcceptConnection(requestor_url, name(),
-                                   mojo::GetProxy(&service_provider));
+    DeliverConnection(requestor_url, name(),
+                      mojo::GetProxy(&service_provider));
     ConnectToService(service_provider.get(), mojo::GetProxy(&content_handler_));
   }
   return content_handler_.get();
 }
 
+void ApplicationInstance::RecordConnection() {
+  RecordActivity();
+  ++num_connections_;
+}
+
+void ApplicationInstance::RecordActivity() {
+  last_activity_ = ftl::TimePoint::Now();
+}
+
+void ApplicationInstance::RequestQuit() {
+  FTL_DCHECK(application_);
+  quit_requested_ = true;
+  application_->RequestQuit();
+}
+
 }  // namespace mojo
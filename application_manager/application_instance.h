@@ -5,17 +5,25 @@
 #ifndef MOJO_APPLICATION_MANAGER_APPLICATION_INSTANCE_H_
 #define MOJO_APPLICATION_MANAGER_APPLICATION_INSTANCE_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_point.h"
 #include "lib/mtl/handles/unique_handle.h"
+#include "mojo/application_manager/application_names.h"
+#include "mojo/application_manager/content_handler_pool.h"
+#include "mojo/application_manager/launch_timeline.h"
 #include "mojo/application_manager/shell_impl.h"
 #include "mojo/public/interfaces/application/application.mojom.h"
 #include "mojo/services/content_handler/interfaces/content_handler.mojom.h"
 
 namespace mojo {
 class ApplicationManager;
+struct PreparedLaunch;
+class WorkerPool;
 
 class ApplicationInstance {
  public:
@@ -28,6 +36,18 @@ class ApplicationInstance {
   // To stop the application, destroy this object.
   bool Start(ApplicationManager* manager, const std::string& name);
 
+  // Like |Start|, but the part of the launch that may block runs on |pool|.
+  // The application can be initialized and sent messages right away; they wait
+  // in the application pipe until the application is running.
+  //
+  // |callback| is called on the current message loop once the launch has
+  // completed, with whether it succeeded. It is called (with false) even if
+  // this object has been destroyed in the meantime.
+  void StartOnPool(ApplicationManager* manager,
+                   const std::string& name,
+                   WorkerPool* pool,
+                   std::function<void(bool)> callback);
+
   // Sends the initialize message to the application.
   //
   // Creates a message pipe for the shell and binds the given shell to that
@@ -39,23 +59,105 @@ class ApplicationInstance {
                   mojo::Array<mojo::String> args,
                   const mojo::String& name);
 
+  // Gives the application a connection. Until the application has processed
+  // its initialize message, connections are queued and then delivered
+  // together, in the order they arrived, so a burst of connections to an
+  // application that is still starting does not pile up ahead of it. An
+  // application that has not acknowledged its initialization after a while
+  // is sent its connections anyway.
+  //
+  // Counts as activity (see |RecordConnection|).
+  void AcceptConnection(const std::string& requestor_name,
+                        const std::string& url,
+                        InterfaceRequest<ServiceProvider> services);
+
   mojo::ContentHandler* GetOrCreateContentHandler();
 
+  // Notes that the application has been given a connection (or, for a content
+  // handler, an application to run), which counts as activity.
+  void RecordConnection();
+
+  // Notes that the application has used the application manager, for example
+  // by connecting to another application, which counts as activity.
+  void RecordActivity();
+
+  // Asks the application to quit. It is expected to close its pipe soon after.
+  void RequestQuit();
+
   mx_handle_t process() const { return process_.get(); }
   mojo::Application* application() const { return application_.get(); }
 
   bool is_initialized() const { return !!shell_; }
+  // Whether the application has been initialized and has acknowledged it.
+  bool is_ready() const { return is_ready_; }
+  // How long the application took from being started to acknowledging its
+  // initialization. Zero until it is ready.
+  ftl::TimeDelta time_to_ready() const { return time_to_ready_; }
+  bool quit_requested() const { return quit_requested_; }
+  ftl::TimePoint last_activity() const { return last_activity_; }
+  size_t num_connections() const { return num_connections_; }
   const std::string& name() const { return shell_->name(); }
+  // The content handler (or replica of one) running this application, if it
+  // was not launched as a process of its own.
+  ApplicationId content_handler_id() const { return content_handler_id_; }
 
   void set_connection_error_handler(const Closure& error_handler) {
     application_.set_connection_error_handler(error_handler);
   }
 
+  // Called once the launch is over: when the application is ready and has been
+  // sent its first connection, or when this object is destroyed if that is
+  // sooner. In the latter case, the stages not reached are unset.
+  void set_launch_finished_callback(
+      std::function<void(const LaunchTimeline&)> callback) {
+    launch_finished_callback_ = std::move(callback);
+  }
+
  private:
+  struct PendingConnection {
+    std::string requestor_name;
+    std::string url;
+    InterfaceRequest<ServiceProvider> services;
+  };
+
+  bool FinishStart(ApplicationManager* manager, PreparedLaunch launch);
+  // Like |AcceptConnection|, but does not count as activity.
+  void DeliverConnection(const std::string& requestor_name,
+                         const std::string& url,
+                         InterfaceRequest<ServiceProvider> services);
+  // Sends a connection to the application, without queueing it.
+  void SendConnection(const std::string& requestor_name,
+                      const std::string& url,
+                      InterfaceRequest<ServiceProvider> services);
+  // Stops queueing connections and sends the ones that were queued.
+  void SendPendingConnections();
+  void OnReady();
+  void OnReadyTimeout();
+  // Calls the launch finished callback, unless it has been called already.
+  void ReportLaunch();
+
   mtl::UniqueHandle process_;
   mojo::ApplicationPtr application_;
   mojo::ContentHandlerPtr content_handler_;
   std::unique_ptr<ShellImpl> shell_;
+  // Held while this application is run by a pooled content handler.
+  std::unique_ptr<ContentHandlerPool::Lease> content_handler_lease_;
+  const ftl::TimePoint start_time_;
+  LaunchTimeline timeline_;
+  std::function<void(const LaunchTimeline&)> launch_finished_callback_;
+  bool launch_reported_ = false;
+  bool is_ready_ = false;
+  ftl::TimeDelta time_to_ready_;
+  // Whether connections are queued rather than sent: until the application is
+  // ready, or has taken too long to become ready.
+  bool holding_connections_ = true;
+  std::vector<PendingConnection> pending_connections_;
+  ftl::TimePoint last_activity_;
+  size_t num_connections_ = 0;
+  ApplicationId content_handler_id_ = kInvalidApplicationId;
+  bool quit_requested_ = false;
+
+  ftl::WeakPtrFactory<ApplicationInstance> weak_factory_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationInstance);
 };
@@ -4,6 +4,7 @@
 
 #include "mojo/application_manager/application_launcher.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -13,14 +14,18 @@
 #include <launchpad/launchpad.h>
 #include <magenta/processargs.h>
 #include <magenta/syscalls.h>
+#include <magenta/syscalls/object.h>
 #include <mxio/util.h>
 
 #include "lib/ftl/files/unique_fd.h"
+#include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/logging.h"
-#include "lib/mtl/legacy_data_pipe/files.h"
-#include "lib/mtl/tasks/message_loop.h"
 #include "mojo/application_manager/application_manager.h"
+#include "mojo/application_manager/launchpad_pool.h"
+#include "mojo/application_manager/resolved_application_cache.h"
+#include "mojo/application_manager/worker_pool.h"
 #include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/cpp/system/wait.h"
 
 namespace mojo {
 namespace {
@@ -35,11 +40,69 @@ constexpr char kMojoMagic[] = "#!mojo ";
 constexpr size_t kMojoMagicLength = sizeof(kMojoMagic) - 1;
 constexpr size_t kMaxShebangLength = 2048;
 
-void Ignored(bool success, ftl::UniqueFD fd) {
-  // There's not much we can do with this success value. If we didn't succeed in
-  // filling the data pipe with content, that could just mean the content
-  // handler wasn't interested in the data and closed its end of the pipe before
-  // reading all the data.
+// Content no larger than this is streamed ahead of larger content, so that a
+// small script is not stuck behind a large bundle.
+constexpr size_t kSmallContentSize = 64 * 1024;
+
+// While the pipe is full, a stream checks this often whether the I/O pool is
+// shutting down.
+constexpr MojoDeadline kStreamWaitSliceMicroseconds = 100 * 1000;
+
+// A content handler that has not made room in the pipe for this long is taken
+// to be stuck, and its stream is abandoned so that it does not hold an I/O
+// thread, and so other launches, hostage.
+constexpr MojoDeadline kStreamStallTimeoutMicroseconds = 30 * 1000 * 1000;
+
+// Copies the file open as |fd| into |producer|, blocking until the content
+// handler has taken all of it or has closed its end of the pipe, until the
+// content handler stops draining the pipe, or until |io_pool| starts shutting
+// down. Must be run on |io_pool|.
+//
+// There's not much we can do if this fails. If we didn't succeed in filling
+// the data pipe with content, that could just mean the content handler wasn't
+// interested in the data and closed its end of the pipe before reading all the
+// data.
+void StreamFileToDataPipe(ftl::UniqueFD fd,
+                          ScopedDataPipeProducerHandle producer,
+                          WorkerPool* io_pool) {
+  MojoDeadline stalled_for = 0;
+  for (;;) {
+    void* buffer = nullptr;
+    uint32_t buffer_size = 0;
+    MojoResult result = BeginWriteDataRaw(producer.get(), &buffer, &buffer_size,
+                                          MOJO_WRITE_DATA_FLAG_NONE);
+    if (result == MOJO_RESULT_SHOULD_WAIT) {
+      result = Wait(producer.get(), MOJO_HANDLE_SIGNAL_WRITABLE,
+                    kStreamWaitSliceMicroseconds, nullptr);
+      if (result == MOJO_RESULT_DEADLINE_EXCEEDED) {
+        stalled_for += kStreamWaitSliceMicroseconds;
+        if (io_pool->IsShuttingDown())
+          return;
+        if (stalled_for >= kStreamStallTimeoutMicroseconds) {
+          FTL_LOG(WARNING) << "Content handler stopped reading its content; "
+                           << "giving up on streaming it";
+          return;
+        }
+        continue;
+      }
+      if (result != MOJO_RESULT_OK)
+        return;
+      continue;
+    }
+    if (result != MOJO_RESULT_OK)
+      return;
+    stalled_for = 0;
+
+    // Read straight into the pipe's buffer rather than through a copy.
+    ssize_t count;
+    do {
+      count = read(fd.get(), buffer, buffer_size);
+    } while (count < 0 && errno == EINTR);
+    EndWriteDataRaw(producer.get(),
+                    count > 0 ? static_cast<uint32_t>(count) : 0u);
+    if (count <= 0)
+      return;
+  }
 }
 
 std::string GetPathFromApplicationName(const std::string& name) {
@@ -61,82 +124,191 @@ std::string GetUriFromPath(const std::string& path) {
   return kFileUriPrefix + path;
 }
 
-mojo::InterfaceRequest<mojo::Application> LaunchWithContentHandler(
-    ApplicationManager* manager,
-    const std::string& path,
-    mojo::InterfaceRequest<mojo::Application> request) {
-  ftl::UniqueFD fd(open(path.c_str(), O_RDONLY));
-  if (!fd.is_valid())
-    return request;
-  std::string shebang(kMaxShebangLength, '\0');
-  ssize_t count = read(fd.get(), &shebang[0], shebang.length());
+// Reads the start of the file open as |fd| and, if it has mojo magic, returns
+// the name of the content handler it asks for. Otherwise, returns an empty
+// string. Either way, |*ok| is set to whether |fd| could be rewound to the
+// start of the file, ready to be read again.
+//
+// Only the magic is read at first, so native executables, which are by far
+// the most common, cost a single small read.
+std::string ReadContentHandlerName(int fd, bool* ok) {
+  *ok = false;
+  char magic[kMojoMagicLength];
+  ssize_t count = read(fd, magic, kMojoMagicLength);
   if (count == -1)
-    return request;
-  if (shebang.find(kMojoMagic) != 0)
-    return request;
-  size_t newline = shebang.find('\n', kMojoMagicLength);
-  if (newline == std::string::npos)
-    return request;
-  if (lseek(fd.get(), 0, SEEK_SET) == -1)
-    return request;
-  std::string handler =
-      shebang.substr(kMojoMagicLength, newline - kMojoMagicLength);
-  URLResponsePtr response = URLResponse::New();
-  response->status_code = 200;
-  response->url = GetUriFromPath(path);
-  mojo::DataPipe data_pipe;
-  URLBodyPtr body = URLBody::New();
-  body->set_stream(std::move(data_pipe.consumer_handle));
-  response->body = std::move(body);
-  mtl::LegacyCopyFromFileDescriptor(
-      std::move(fd), std::move(data_pipe.producer_handle),
-      // TODO(abarth): Move file tasks to a background thread.
-      mtl::MessageLoop::GetCurrent()->task_runner(), Ignored);
-  manager->StartApplicationUsingContentHandler(handler, std::move(response),
-                                               std::move(request));
-  return nullptr;
+    return std::string();
+
+  std::string handler;
+  if (static_cast<size_t>(count) == kMojoMagicLength &&
+      memcmp(magic, kMojoMagic, kMojoMagicLength) == 0) {
+    std::string shebang(kMaxShebangLength - kMojoMagicLength, '\0');
+    count = read(fd, &shebang[0], shebang.length());
+    if (count == -1)
+      return std::string();
+    size_t newline = shebang.find('\n');
+    if (newline < static_cast<size_t>(count))
+      handler = shebang.substr(0, newline);
+  }
+
+  if (lseek(fd, 0, SEEK_SET) == -1)
+    return std::string();
+  *ok = true;
+  return handler;
 }
 
-// TODO(abarth): We should use the fd we opened in LaunchWithContentHandler
-// rather than using the path again.
 mtl::UniqueHandle LaunchWithProcess(
     const std::string& path,
-    mojo::InterfaceRequest<mojo::Application> request) {
+    ftl::UniqueFD fd,
+    LaunchpadPool* launchpads,
+    mojo::InterfaceRequest<mojo::Application> request,
+    LaunchTimeline* timeline) {
+  // Load the executable from the file we already have open, rather than
+  // having launchpad look up and open the path again.
+  mx_handle_t vmo = launchpad_vmo_from_fd(fd.get());
+  if (vmo < 0)
+    return mtl::UniqueHandle();
+  fd.reset();
+
   const char* path_arg = path.c_str();
   mx_handle_t request_handle =
       static_cast<mx_handle_t>(request.PassMessagePipe().release().value());
   uint32_t request_id = MX_HND_TYPE_APPLICATION_REQUEST;
-  // TODO(abarth): We shouldn't pass stdin, stdout, stderr, or the file system
-  // when launching Mojo applications. We probably shouldn't pass environ, but
-  // currently this is very useful as a way to tell the loader in the child
-  // process to print out load addresses so we can understand crashes.
-  mx_handle_t result = launchpad_launch_mxio_etc(
-      path_arg, 1, &path_arg, environ, 1, &request_handle, &request_id);
+
+  // The parts of the launch that do not depend on the executable have usually
+  // been done ahead of time by |launchpads|.
+  launchpad_t* lp = launchpads ? launchpads->Take()
+                               : LaunchpadPool::CreateLaunchpad(path_arg);
+  if (!lp) {
+    mx_handle_close(vmo);
+    mx_handle_close(request_handle);
+    return mtl::UniqueHandle();
+  }
+  timeline->Mark(LaunchTimeline::Stage::kLaunchpadCreated);
+  if (launchpads) {
+    // The name only helps debugging, so failing to set it is not fatal.
+    mx_object_set_property(launchpad_get_process_handle(lp), MX_PROP_NAME,
+                           path_arg, path.length());
+  }
+  // Each step stops at the first error.
+  mx_status_t status = launchpad_elf_load(lp, vmo);
+  if (status == NO_ERROR)
+    status = launchpad_arguments(lp, 1, &path_arg);
+  if (status == NO_ERROR) {
+    status = launchpad_add_handles(lp, 1, &request_handle, &request_id);
+  } else {
+    mx_handle_close(request_handle);
+  }
+  mx_handle_t result = status == NO_ERROR ? launchpad_start(lp) : status;
+  launchpad_destroy(lp);
   if (result < 0)
     return mtl::UniqueHandle();
+  timeline->Mark(LaunchTimeline::Stage::kProcessStarted);
   return mtl::UniqueHandle(result);
 }
 
 }  // namespace
 
-std::pair<bool, mtl::UniqueHandle> LaunchApplication(
-    ApplicationManager* manager,
+PreparedLaunch::PreparedLaunch() = default;
+
+PreparedLaunch::PreparedLaunch(PreparedLaunch&& other) = default;
+
+PreparedLaunch& PreparedLaunch::operator=(PreparedLaunch&& other) = default;
+
+PreparedLaunch::~PreparedLaunch() = default;
+
+PreparedLaunch PrepareLaunch(
     const std::string& name,
+    LaunchpadPool* launchpads,
+    ResolvedApplicationCache* cache,
     mojo::InterfaceRequest<mojo::Application> request) {
+  PreparedLaunch launch;
   std::string path = GetPathFromApplicationName(name);
   if (path.empty())
-    return std::make_pair(false, mtl::UniqueHandle());
+    return launch;
+  launch.timeline.Mark(LaunchTimeline::Stage::kNameResolved);
 
-  request = LaunchWithContentHandler(manager, path, std::move(request));
-  if (!request.is_pending()) {
-    // LaunchWithContentHandler has consumed the interface request, which
-    // means we succeeded in kicking off the load process.
-    return std::make_pair(true, mtl::UniqueHandle());
+  // The file is opened once and this fd serves both to tell content from
+  // native executables and as the source of whichever it turns out to be.
+  ftl::UniqueFD fd(open(path.c_str(), O_RDONLY));
+  if (!fd.is_valid()) {
+    if (cache)
+      cache->Erase(path);
+    return launch;
   }
+  launch.timeline.Mark(LaunchTimeline::Stage::kFileOpened);
+  struct stat info;
+  bool has_info = fstat(fd.get(), &info) == 0;
+
+  // An unchanged file is classified as it was last time, without reading it.
+  std::string handler;
+  if (!cache || !has_info || !cache->Lookup(path, info, &handler)) {
+    bool rewound = false;
+    handler = ReadContentHandlerName(fd.get(), &rewound);
+    if (!rewound)
+      return launch;
+    if (cache && has_info)
+      cache->Store(path, ResolvedApplication(info, handler));
+  }
+  launch.timeline.Mark(LaunchTimeline::Stage::kFileClassified);
+
+  if (!handler.empty()) {
+    if (has_info && info.st_size > 0)
+      launch.file_size = static_cast<size_t>(info.st_size);
+    launch.success = true;
+    launch.content_handler = std::move(handler);
+    launch.path = std::move(path);
+    launch.fd = std::move(fd);
+    launch.request = std::move(request);
+    return launch;
+  }
+
+  launch.process = LaunchWithProcess(path, std::move(fd), launchpads,
+                                     std::move(request), &launch.timeline);
+  launch.success = launch.process.is_valid();
+  return launch;
+}
+
+std::pair<bool, mtl::UniqueHandle> CompleteLaunch(
+    ApplicationManager* manager,
+    PreparedLaunch launch,
+    std::unique_ptr<ContentHandlerPool::Lease>* lease) {
+  if (launch.content_handler.empty())
+    return std::make_pair(launch.success, std::move(launch.process));
 
-  mtl::UniqueHandle handle = LaunchWithProcess(path, std::move(request));
-  bool success = handle.is_valid();
-  return std::make_pair(success, std::move(handle));
+  URLResponsePtr response = URLResponse::New();
+  response->status_code = 200;
+  response->url = GetUriFromPath(launch.path);
+  mojo::DataPipe data_pipe;
+  URLBodyPtr body = URLBody::New();
+  body->set_stream(std::move(data_pipe.consumer_handle));
+  response->body = std::move(body);
+  WorkerPool::Priority priority = launch.file_size <= kSmallContentSize
+                                     ? WorkerPool::Priority::kHigh
+                                     : WorkerPool::Priority::kNormal;
+  WorkerPool* io_pool = manager->io_pool();
+  io_pool->PostTask(
+      ftl::MakeCopyable([
+        fd = std::move(launch.fd),
+        producer = std::move(data_pipe.producer_handle), io_pool
+      ]() mutable {
+        StreamFileToDataPipe(std::move(fd), std::move(producer), io_pool);
+      }),
+      priority);
+  auto content_handler_lease = manager->StartApplicationUsingContentHandler(
+      launch.content_handler, std::move(response), std::move(launch.request));
+  if (lease)
+    *lease = std::move(content_handler_lease);
+  return std::make_pair(true, mtl::UniqueHandle());
+}
+
+std::pair<bool, mtl::UniqueHandle> LaunchApplication(
+    ApplicationManager* manager,
+    const std::string& name,
+    mojo::InterfaceRequest<mojo::Application> request) {
+  return CompleteLaunch(
+      manager,
+      PrepareLaunch(name, manager->launchpad_pool(),
+                    manager->resolved_application_cache(), std::move(request)));
 }
 
 }  // namespace mojo
@@ -6,15 +6,77 @@
 #define MOJO_APPLICATION_MANAGER_APPLICATION_LAUNCHER_H_
 
 #include <magenta/types.h>
+#include <memory>
 #include <string>
 #include <utility>
 
+#include "lib/ftl/files/unique_fd.h"
 #include "lib/ftl/macros.h"
 #include "lib/mtl/handles/unique_handle.h"
+#include "mojo/application_manager/content_handler_pool.h"
+#include "mojo/application_manager/launch_timeline.h"
 #include "mojo/public/interfaces/application/application.mojom.h"
 
 namespace mojo {
 class ApplicationManager;
+class LaunchpadPool;
+class ResolvedApplicationCache;
+
+// The outcome of |PrepareLaunch|, to be finished by |CompleteLaunch|.
+struct PreparedLaunch {
+  PreparedLaunch();
+  PreparedLaunch(PreparedLaunch&& other);
+  PreparedLaunch& operator=(PreparedLaunch&& other);
+  ~PreparedLaunch();
+
+  // Whether the application request was delivered to a new process, or is
+  // ready to be handed to |content_handler|.
+  bool success = false;
+
+  // The process created for a native executable.
+  mtl::UniqueHandle process;
+
+  // For a file with mojo magic: the name of the content handler application,
+  // the path and an open file descriptor for the content, and the application
+  // request that the content handler should bind.
+  std::string content_handler;
+  std::string path;
+  ftl::UniqueFD fd;
+  size_t file_size = 0;
+  mojo::InterfaceRequest<mojo::Application> request;
+
+  // The stages of the launch reached so far.
+  LaunchTimeline timeline;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PreparedLaunch);
+};
+
+// Does the part of |LaunchApplication| that may block: resolves the name, reads
+// the file to tell native executables from content, and creates the process
+// for native executables. Does not touch the application manager, so it may be
+// called on any thread.
+//
+// If |launchpads| is not null, native executables are launched with a
+// launchpad taken from it. If |cache| is not null, it is consulted for how the
+// file was classified before and updated with what was found.
+PreparedLaunch PrepareLaunch(
+    const std::string& name,
+    LaunchpadPool* launchpads,
+    ResolvedApplicationCache* cache,
+    mojo::InterfaceRequest<mojo::Application> application_request);
+
+// Finishes a launch started by |PrepareLaunch|, handing content to its content
+// handler. The content is streamed to the handler on the manager's I/O pool.
+// Must be called on the application manager's message loop. Returns the same
+// values as |LaunchApplication|.
+//
+// If the content handler is pooled and |lease| is not null, |*lease| is set to
+// the lease that counts the application against the replica running it; the
+// caller should hold it for as long as the application runs.
+std::pair<bool, mtl::UniqueHandle> CompleteLaunch(
+    ApplicationManager* manager,
+    PreparedLaunch launch,
+    std::unique_ptr<ContentHandlerPool::Lease>* lease = nullptr);
 
 // Starts the application with the given name.
 //
@@ -32,6 +94,9 @@ class ApplicationManager;
 //
 // The second field of the return value is a handle to the process created by
 // this function, if the name resolved to a native executable.
+//
+// Equivalent to |CompleteLaunch(manager, PrepareLaunch(...))| with the
+// manager's launchpad pool and resolved application cache.
 std::pair<bool, mtl::UniqueHandle> LaunchApplication(
     ApplicationManager* manager,
     const std::string& name,
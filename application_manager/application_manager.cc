@@ -7,75 +7,518 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <utility>
 
 #include "lib/ftl/command_line.h"
 #include "lib/ftl/logging.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/mtl/tasks/message_loop.h"
 #include "mojo/application_manager/application_instance.h"
+#include "mojo/application_manager/connection_profile.h"
+#include "mojo/application_manager/launchpad_pool.h"
+#include "mojo/application_manager/process_memory.h"
 #include "mojo/application_manager/shell_impl.h"
+#include "mojo/application_manager/startup_config.h"
+#include "mojo/application_manager/startup_config_image.h"
+#include "mojo/application_manager/startup_scheduler.h"
+#include "mojo/application_manager/worker_pool.h"
 #include "mojo/public/cpp/bindings/formatting.h"
 
 namespace mojo {
+namespace {
 
-ApplicationManager::ApplicationManager(ApplicationArgs args_for)
-    : args_for_(std::move(args_for)) {}
+constexpr char kApplicationManagerName[] = "mojo:application_manager";
+
+// Launching is mostly waiting on the file system and on process creation, so
+// a few threads are enough to overlap the launches of independent apps.
+constexpr size_t kNumLaunchThreads = 4;
+
+// Enough prepared launchpads to cover a burst of launches while the pool is
+// refilled, without holding many idle processes.
+constexpr size_t kNumPreparedLaunchpads = 2;
+
+// Streaming a file mostly waits on its content handler to drain the data
+// pipe. More threads would let more streams make progress at once, but would
+// also let large payloads compete with each other for the disk.
+constexpr size_t kNumIOThreads = 2;
+
+// Speculative launches compete with the launches that were asked for, so only
+// this many may be in flight at once.
+constexpr size_t kMaxSpeculativeLaunches = 4;
+
+// A speculatively launched application that has had no connection this long
+// after starting was launched for nothing, and is asked to quit.
+constexpr ftl::TimeDelta kPrelaunchGracePeriod =
+    ftl::TimeDelta::FromSeconds(30);
+
+// Names that never ran, and instances of instance-per-query applications that
+// have stopped, are kept for their counters until this many more have
+// followed them.
+constexpr size_t kMaxRetiredNames = 64;
+
+// Names that the launcher cannot resolve are refused before they are
+// interned, so that asking for them repeatedly takes up no memory.
+bool CheckLaunchable(const std::string& name) {
+  if (ApplicationNames::IsLaunchable(name))
+    return true;
+  fprintf(stderr, "application_manager: Failed to start application %s\n",
+          name.c_str());
+  return false;
+}
+
+void AddCounters(const ApplicationCounters& counters,
+                 ApplicationCounters* total) {
+  total->num_launches += counters.num_launches;
+  total->num_launch_failures += counters.num_launch_failures;
+  total->num_terminations += counters.num_terminations;
+  total->num_requested_quits += counters.num_requested_quits;
+  total->num_connections += counters.num_connections;
+  total->num_content_handler_requests += counters.num_content_handler_requests;
+  total->num_content_handler_failures += counters.num_content_handler_failures;
+}
+
+}  // namespace
+
+ApplicationManager::ApplicationManager(
+    ApplicationArgs args_for,
+    std::unordered_set<std::string> instance_per_query)
+    : table_(&names_), stats_service_(this), weak_factory_(this) {
+  names_.set_instance_per_query(std::move(instance_per_query));
+  self_id_ = names_.Intern(kApplicationManagerName);
+  SetArgsFor(std::move(args_for));
+}
 
 ApplicationManager::~ApplicationManager() {}
 
 void ApplicationManager::ConnectToApplication(
     const std::string& application_name,
-    const std::string& requestor_name,
+    ApplicationId requestor_id,
     InterfaceRequest<ServiceProvider> services) {
-  ApplicationInstance* instance =
-      GetOrStartApplicationInstance(std::move(application_name));
+  if (!CheckLaunchable(application_name))
+    return;
+  ApplicationId id = names_.Intern(application_name);
+  if (id == self_id_) {
+    stats_service_.AddBinding(std::move(services));
+    return;
+  }
+  ++counters_[id].num_connections;
+  // An application that is connecting to others is in use, even if nothing
+  // has connected to it in a while.
+  if (ApplicationInstance* requestor = table_.GetApplication(requestor_id))
+    requestor->RecordActivity();
+  if (connection_profile_ && requestor_id != self_id_) {
+    connection_profile_->OnConnection(names_.GetName(requestor_id),
+                                      names_.GetName(id));
+  }
+  ApplicationInstance* instance = GetOrStartApplicationInstance(id, nullptr);
   if (!instance)
     return;
-  instance->application()->AcceptConnection(requestor_name, application_name,
-                                            std::move(services));
+  // The application is given the name as it was asked for, so it can still
+  // see any query that is not part of its identity.
+  instance->AcceptConnection(names_.GetName(requestor_id), application_name,
+                             std::move(services));
 }
 
-void ApplicationManager::StartApplicationUsingContentHandler(
+std::unique_ptr<ContentHandlerPool::Lease>
+ApplicationManager::StartApplicationUsingContentHandler(
     const std::string& content_handler_name,
     URLResponsePtr response,
     InterfaceRequest<Application> application_request) {
-  ApplicationInstance* instance =
-      GetOrStartApplicationInstance(content_handler_name);
-  if (!instance)
-    return;
+  if (!CheckLaunchable(content_handler_name))
+    return nullptr;
+  ApplicationId handler_id = names_.Intern(content_handler_name);
+  ++counters_[handler_id].num_content_handler_requests;
+  ApplicationId id = handler_id;
+
+  std::unique_ptr<ContentHandlerPool::Lease> lease;
+  auto pool_it = content_handler_pools_.find(id);
+  if (pool_it != content_handler_pools_.end()) {
+    lease = pool_it->second->Dispatch(response->url);
+    id = names_.InternReplica(id, lease->replica());
+  }
+
+  ApplicationInstance* instance = GetOrStartApplicationInstance(id, nullptr);
+  if (!instance) {
+    ++counters_[handler_id].num_content_handler_failures;
+    return nullptr;
+  }
+  instance->RecordConnection();
   ContentHandler* content_handler = instance->GetOrCreateContentHandler();
   content_handler->StartApplication(std::move(application_request),
                                     std::move(response));
+  return lease;
+}
+
+void ApplicationManager::SetContentHandlerPools(
+    const std::unordered_map<std::string, ContentHandlerPool::Options>&
+        options) {
+  // Existing pools are updated rather than replaced, so that they go on
+  // tracking, and eventually stopping, the replicas they have started.
+  std::unordered_set<ApplicationId> ids;
+  for (const auto& entry : options) {
+    ApplicationId id = names_.Intern(entry.first);
+    ids.insert(id);
+    auto it = content_handler_pools_.find(id);
+    if (it != content_handler_pools_.end()) {
+      it->second->SetOptions(entry.second);
+      continue;
+    }
+    content_handler_pools_[id] = std::make_unique<ContentHandlerPool>(
+        entry.second, [this, id](size_t replica) {
+          ApplicationInstance* instance =
+              table_.GetApplication(names_.InternReplica(id, replica));
+          if (instance && instance->is_initialized() &&
+              !instance->quit_requested())
+            instance->RequestQuit();
+        });
+  }
+  // A pool with the default options sends everything to replica 0, like no
+  // pool at all, and stops its other replicas once they are idle.
+  for (const auto& entry : content_handler_pools_) {
+    if (!ids.count(entry.first))
+      entry.second->SetOptions(ContentHandlerPool::Options());
+  }
 }
 
 ApplicationInstance* ApplicationManager::GetOrStartApplicationInstance(
     std::string name,
     std::vector<std::string>* override_args) {
-  ApplicationInstance* instance = table_.GetOrStartApplication(this, name);
+  if (!CheckLaunchable(name))
+    return nullptr;
+  return GetOrStartApplicationInstance(names_.Intern(name), override_args);
+}
+
+ApplicationInstance* ApplicationManager::GetOrStartApplicationInstance(
+    ApplicationId id,
+    std::vector<std::string>* override_args) {
+  ApplicationInstance* instance = table_.GetOrStartApplication(this, id);
   if (!instance) {
     fprintf(stderr, "application_manager: Failed to start application %s\n",
-            name.c_str());
+            names_.GetName(id).c_str());
+    ++counters_[id].num_launches;
+    RecordLaunchFailure(id);
     return nullptr;
   }
-  if (!instance->is_initialized()) {
-    Array<String> args;
-    if (override_args) {
-      args = Array<String>::From(*override_args);
-    } else {
-      const auto& it = args_for_.find(name);
-      if (it != args_for_.end())
-        args = Array<String>::From(it->second);
+  if (!instance->is_initialized())
+    InitializeInstance(instance, id, override_args);
+  return instance;
+}
+
+void ApplicationManager::StartInitialApplications(
+    std::vector<std::string> names,
+    const ApplicationDependencies& dependencies) {
+  for (const auto& name : names)
+    initial_apps_.insert(names_.Canonicalize(name));
+  UpdateReaper();
+  // Earlier batches may still be starting, if the config was reloaded early.
+  startup_schedulers_.erase(
+      std::remove_if(startup_schedulers_.begin(), startup_schedulers_.end(),
+                     [](const std::unique_ptr<StartupScheduler>& scheduler) {
+                       return scheduler->is_done();
+                     }),
+      startup_schedulers_.end());
+  startup_schedulers_.push_back(std::make_unique<StartupScheduler>(
+      std::move(names), dependencies,
+      [this](const std::string& name, ftl::Closure done) {
+        StartApplicationOnPool(name, [done](bool success) { done(); });
+      }));
+  startup_schedulers_.back()->Start();
+}
+
+void ApplicationManager::StartApplicationOnPool(
+    const std::string& name,
+    std::function<void(bool)> callback) {
+  if (!CheckLaunchable(name)) {
+    callback(false);
+    return;
+  }
+  ApplicationId id = names_.Intern(name);
+  ApplicationInstance* instance = table_.GetOrStartApplicationOnPool(
+      this, id, GetLaunchPool(), [this, id, name, callback](bool success) {
+        if (!success) {
+          fprintf(stderr,
+                  "application_manager: Failed to start application %s\n",
+                  name.c_str());
+          RecordLaunchFailure(id);
+        }
+        callback(success);
+      });
+  if (instance && !instance->is_initialized())
+    InitializeInstance(instance, id, nullptr);
+}
+
+void ApplicationManager::InitializeInstance(
+    ApplicationInstance* instance,
+    ApplicationId id,
+    std::vector<std::string>* override_args) {
+  const std::string& name = names_.GetName(id);
+  ++counters_[id].num_launches;
+  Array<String> args;
+  if (override_args) {
+    args = Array<String>::From(*override_args);
+  } else {
+    // Replicas of a content handler take the arguments of the handler. Their
+    // names are not canonical forms of anything the config can name, so
+    // canonicalizing them would not find the handler's arguments.
+    std::vector<std::string> configured_args;
+    if (FindArgsFor(names_.GetBaseName(id), &configured_args))
+      args = Array<String>::From(configured_args);
+  }
+  FTL_DLOG(INFO) << "Starting application: \"" << name
+                 << "\", with args: " << args;
+  instance->Initialize(std::make_unique<ShellImpl>(id, this), std::move(args),
+                       name);
+  instance->set_launch_finished_callback(
+      [this, id](const LaunchTimeline& timeline) {
+        launch_tracer_.RecordLaunch(names_.GetName(id), timeline);
+      });
+  instance->set_connection_error_handler([this, instance, id]() {
+    FTL_DLOG(INFO) << "Application terminated: \"" << instance->name()
+                   << "\"";
+    // A quit that was asked for is not a crash, so it is counted apart.
+    if (instance->quit_requested())
+      ++counters_[id].num_requested_quits;
+    else
+      ++counters_[id].num_terminations;
+    // Stopping the application destroys this handler, so nothing it captured
+    // is used afterwards.
+    ApplicationManager* manager = this;
+    ApplicationId stopped_id = id;
+    table_.StopApplication(id);
+    if (manager->application_stopped_callback_)
+      manager->application_stopped_callback_(stopped_id);
+    // Each query of an instance-per-query application has a name of its own,
+    // which would otherwise be kept forever.
+    if (manager->names_.IsInstancePerQuery(stopped_id))
+      manager->RetireName(stopped_id);
+  });
+  if (connection_profile_) {
+    connection_profile_->OnLaunched(name);
+    Prelaunch(id);
+  }
+}
+
+void ApplicationManager::EnablePrelaunching(const std::string& profile_path) {
+  connection_profile_ =
+      std::make_unique<ConnectionProfile>(profile_path, io_pool());
+  connection_profile_->Load([profile_path](bool success) {
+    if (!success) {
+      fprintf(stderr,
+              "application_manager: Ignoring malformed connection profile: "
+              "%s\n",
+              profile_path.c_str());
     }
-    FTL_DLOG(INFO) << "Starting application: \"" << name
-                   << "\", with args: " << args;
-    instance->Initialize(std::make_unique<ShellImpl>(name, this),
-                         std::move(args), name);
-    instance->set_connection_error_handler([this, instance]() {
-      FTL_DLOG(INFO) << "Application terminated: \"" << instance->name()
-                     << "\"";
-      table_.StopApplication(instance->name());
+  });
+}
+
+void ApplicationManager::Prelaunch(ApplicationId id) {
+  for (const auto& name :
+       connection_profile_->GetLikelyConnections(names_.GetName(id))) {
+    if (num_speculative_launches_ >= kMaxSpeculativeLaunches)
+      return;
+    if (table_.GetApplication(names_.Find(name)))
+      continue;
+    ++num_speculative_launches_;
+    ftl::WeakPtr<ApplicationManager> weak_this = weak_factory_.GetWeakPtr();
+    StartApplicationOnPool(name, [this, weak_this, name](bool success) {
+      --num_speculative_launches_;
+      if (!success)
+        return;
+      mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+          [weak_this, name] {
+            if (weak_this)
+              weak_this->StopUnusedPrelaunch(name);
+          },
+          kPrelaunchGracePeriod);
     });
   }
-  return instance;
+}
+
+void ApplicationManager::StopUnusedPrelaunch(const std::string& name) {
+  // The reaper would stop an unused application too, but only if there is a
+  // reaping policy with an idle timeout, and prelaunching must not leave
+  // applications running that nothing asked for when there is not.
+  if (initial_apps_.count(name))
+    return;
+  ApplicationInstance* instance = table_.GetApplication(names_.Find(name));
+  if (instance && instance->is_initialized() &&
+      instance->num_connections() == 0 && !instance->quit_requested())
+    instance->RequestQuit();
+}
+
+void ApplicationManager::RecordLaunchFailure(ApplicationId id) {
+  ApplicationCounters& counters = counters_[id];
+  ++counters.num_launch_failures;
+  if (counters.num_launch_failures == counters.num_launches)
+    RetireName(id);
+}
+
+void ApplicationManager::RetireName(ApplicationId id) {
+  if (std::find(retired_ids_.begin(), retired_ids_.end(), id) !=
+      retired_ids_.end())
+    return;
+  retired_ids_.push_back(id);
+  if (retired_ids_.size() <= kMaxRetiredNames)
+    return;
+  ApplicationId oldest = retired_ids_.front();
+  retired_ids_.pop_front();
+  ForgetName(oldest);
+}
+
+void ApplicationManager::ForgetName(ApplicationId id) {
+  // The name may have been asked for again since it was retired.
+  if (id == self_id_ || table_.Contains(id) || content_handler_pools_.count(id))
+    return;
+  ApplicationCounters counters;
+  auto it = counters_.find(id);
+  if (it != counters_.end())
+    counters = it->second;
+  bool instance_per_query = names_.IsInstancePerQuery(id);
+  if (!instance_per_query &&
+      counters.num_launches != counters.num_launch_failures)
+    return;
+  if (it != counters_.end())
+    counters_.erase(it);
+  if (instance_per_query) {
+    const std::string& name = names_.GetName(id);
+    ApplicationId application_id =
+        names_.Intern(name.substr(0, name.find('?')));
+    AddCounters(counters, &counters_[application_id]);
+  }
+  names_.Release(id);
+}
+
+void ApplicationManager::ApplyStartupConfig(
+    StartupConfig* config,
+    std::unique_ptr<StartupConfigImage> image,
+    const ApplicationArgs& args_overrides) {
+  ApplicationArgs args_for = config->TakeArgsFor();
+  for (const auto& entry : args_overrides)
+    args_for[entry.first] = entry.second;
+  SetArgsFor(std::move(args_for));
+  SetConfigImage(std::move(image));
+  SetContentHandlerPools(config->TakeContentHandlers());
+
+  // Applications that are no longer initial applications lose the keep-alive
+  // that came with being one. The application given on the command line
+  // stays one; it is the one with |args_overrides|.
+  std::unordered_set<std::string> initial_apps;
+  for (const auto& entry : args_overrides)
+    initial_apps.insert(names_.Canonicalize(entry.first));
+  std::vector<std::string> new_initial_apps;
+  for (auto& name : config->TakeInitialApps()) {
+    std::string canonical_name = names_.Canonicalize(name);
+    if (!initial_apps_.count(canonical_name))
+      new_initial_apps.push_back(std::move(name));
+    initial_apps.insert(std::move(canonical_name));
+  }
+  initial_apps_ = std::move(initial_apps);
+  SetReapingPolicy(config->TakeReapingPolicy());
+
+  if (!new_initial_apps.empty())
+    StartInitialApplications(std::move(new_initial_apps),
+                             config->TakeDependsOn());
+}
+
+void ApplicationManager::SetArgsFor(ApplicationArgs args_for) {
+  args_for_.clear();
+  for (auto& entry : args_for)
+    args_for_[names_.Canonicalize(entry.first)] = std::move(entry.second);
+}
+
+bool ApplicationManager::FindArgsFor(const std::string& canonical_name,
+                                     std::vector<std::string>* args) const {
+  const auto& it = args_for_.find(canonical_name);
+  if (it != args_for_.end()) {
+    *args = it->second;
+    return true;
+  }
+  if (!config_image_)
+    return false;
+  const auto& alias_it = config_image_aliases_.find(canonical_name);
+  return config_image_->FindArgsFor(alias_it != config_image_aliases_.end()
+                                        ? alias_it->second
+                                        : canonical_name,
+                                    args);
+}
+
+void ApplicationManager::SetConfigImage(
+    std::unique_ptr<StartupConfigImage> image) {
+  config_image_ = std::move(image);
+  config_image_aliases_.clear();
+  if (!config_image_)
+    return;
+  for (size_t i = 0; i < config_image_->num_args_for(); ++i) {
+    std::string name = config_image_->GetArgsForName(i).ToString();
+    std::string canonical_name = names_.Canonicalize(name);
+    if (canonical_name != name)
+      config_image_aliases_[canonical_name] = std::move(name);
+  }
+}
+
+void ApplicationManager::RegisterWithTracing(const std::string& tracing_app) {
+  ServiceProviderPtr tracing_services;
+  ConnectToApplication(tracing_app, self_id_, GetProxy(&tracing_services));
+  launch_tracer_.RegisterWithTracing(std::move(tracing_services));
+}
+
+void ApplicationManager::SetReapingPolicy(ReapingPolicy policy) {
+  CanonicalizePolicy(&policy);
+  reaping_policy_ = std::move(policy);
+  UpdateReaper();
+}
+
+void ApplicationManager::UpdateReaper() {
+  if (!reaping_policy_.is_enabled()) {
+    reaper_.reset();
+    return;
+  }
+  // The initial applications are kept alive as well, since nothing would
+  // start them again.
+  ReapingPolicy policy = reaping_policy_;
+  policy.keep_alive.insert(initial_apps_.begin(), initial_apps_.end());
+  if (reaper_)
+    *reaper_->policy() = std::move(policy);
+  else
+    reaper_ = std::make_unique<ApplicationReaper>(&table_, std::move(policy));
+}
+
+uint64_t ApplicationManager::GetMemoryUsage(ApplicationId id) const {
+  ApplicationInstance* instance = table_.GetApplication(id);
+  return instance ? GetProcessMemoryUsage(instance->process()) : 0u;
+}
+
+void ApplicationManager::CanonicalizePolicy(ReapingPolicy* policy) const {
+  std::unordered_map<std::string, ftl::TimeDelta> idle_timeouts;
+  for (const auto& entry : policy->idle_timeouts)
+    idle_timeouts[names_.Canonicalize(entry.first)] = entry.second;
+  policy->idle_timeouts = std::move(idle_timeouts);
+
+  std::unordered_set<std::string> keep_alive;
+  for (const auto& name : policy->keep_alive)
+    keep_alive.insert(names_.Canonicalize(name));
+  policy->keep_alive = std::move(keep_alive);
+}
+
+WorkerPool* ApplicationManager::io_pool() {
+  if (!io_pool_)
+    io_pool_ = std::make_unique<WorkerPool>(kNumIOThreads);
+  return io_pool_.get();
+}
+
+LaunchpadPool* ApplicationManager::launchpad_pool() {
+  if (!launchpad_pool_) {
+    launchpad_pool_ = std::make_unique<LaunchpadPool>(kNumPreparedLaunchpads,
+                                                      GetLaunchPool());
+  }
+  return launchpad_pool_.get();
+}
+
+WorkerPool* ApplicationManager::GetLaunchPool() {
+  if (!launch_pool_)
+    launch_pool_ = std::make_unique<WorkerPool>(kNumLaunchThreads);
+  return launch_pool_.get();
 }
 
 }  // namespace mojo
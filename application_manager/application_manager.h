@@ -5,41 +5,257 @@
 #ifndef MOJO_APPLICATION_MANAGER_APPLICATION_MANAGER_H_
 #define MOJO_APPLICATION_MANAGER_APPLICATION_MANAGER_H_
 
+#include <deque>
+#include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "lib/ftl/command_line.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "mojo/application_manager/application_names.h"
+#include "mojo/application_manager/application_reaper.h"
 #include "mojo/application_manager/application_table.h"
+#include "mojo/application_manager/content_handler_pool.h"
+#include "mojo/application_manager/launch_tracer.h"
+#include "mojo/application_manager/resolved_application_cache.h"
+#include "mojo/application_manager/stats_service.h"
 #include "mojo/public/interfaces/application/service_provider.mojom.h"
 #include "mojo/public/interfaces/network/url_response.mojom.h"
 
 namespace mojo {
+class ApplicationReaper;
+class ConnectionProfile;
+class LaunchpadPool;
+class StartupConfig;
+class StartupConfigImage;
+class StartupScheduler;
+class WorkerPool;
 
 using ApplicationArgs =
     std::unordered_map<std::string, std::vector<std::string>>;
 
+// Maps an application name to the names of the applications that must be
+// launched before it.
+using ApplicationDependencies =
+    std::unordered_map<std::string, std::vector<std::string>>;
+
+// What has happened to one application since the application manager
+// started.
+struct ApplicationCounters {
+  uint32_t num_launches = 0;
+  uint32_t num_launch_failures = 0;
+  uint32_t num_terminations = 0;
+  uint32_t num_requested_quits = 0;
+  uint64_t num_connections = 0;
+  uint64_t num_content_handler_requests = 0;
+  uint64_t num_content_handler_failures = 0;
+};
+
 class ApplicationManager {
  public:
-  explicit ApplicationManager(ApplicationArgs args_for);
+  // |instance_per_query| lists the applications that get a separate instance
+  // for each query (see |ApplicationNames|).
+  explicit ApplicationManager(
+      ApplicationArgs args_for,
+      std::unordered_set<std::string> instance_per_query =
+          std::unordered_set<std::string>());
   ~ApplicationManager();
 
+  // The canonical names of the applications, interned.
+  ApplicationNames* names() { return &names_; }
+
+  // The id of the application manager itself, as the requestor of the
+  // connections it makes on its own behalf.
+  ApplicationId self_id() const { return self_id_; }
+
   void ConnectToApplication(const std::string& application_name,
-                            const std::string& requestor_name,
+                            ApplicationId requestor_id,
                             InterfaceRequest<ServiceProvider> services);
 
-  void StartApplicationUsingContentHandler(
+  // Asks the content handler to run the application. If the content handler is
+  // pooled (see |SetContentHandlerPools|), returns the lease that counts the
+  // application against the replica running it.
+  std::unique_ptr<ContentHandlerPool::Lease>
+  StartApplicationUsingContentHandler(
       const std::string& content_handler_name,
       URLResponsePtr response,
       InterfaceRequest<Application> application_request);
 
+  // Applies a config that has been reloaded, without disturbing the
+  // applications that are running: applications newly listed as initial
+  // applications are started, and new arguments apply from the next launch of
+  // each application. The reaping policy is replaced, and the content handler
+  // pools are updated. Applications that are no longer initial applications
+  // keep running, but are no longer kept alive for being one.
+  // "instance-per-query", "tracing-app" and "connection-profile" only take
+  // effect when the application manager starts.
+  //
+  // |args_overrides| take precedence over the arguments in |config|, like the
+  // arguments given on the command line do at startup.
+  void ApplyStartupConfig(StartupConfig* config,
+                          std::unique_ptr<StartupConfigImage> image,
+                          const ApplicationArgs& args_overrides);
+
+  // Replaces the arguments for each application, from the next launch.
+  void SetArgsFor(ApplicationArgs args_for);
+
+  // Looks up the arguments of applications that have none in |args_for| in
+  // |image| instead, as they are launched.
+  void SetConfigImage(std::unique_ptr<StartupConfigImage> image);
+
+  // Runs the applications of each content handler named in |options| on a
+  // pool of replicas of it, as configured. Replicas that a content handler no
+  // longer has room for are stopped once they are idle.
+  void SetContentHandlerPools(
+      const std::unordered_map<std::string, ContentHandlerPool::Options>&
+          options);
+
   ApplicationInstance* GetOrStartApplicationInstance(
       std::string name,
       std::vector<std::string>* override_args = nullptr);
 
+  // Starts the initial applications from the startup config. The part of each
+  // launch that may block runs on a pool of worker threads, so independent
+  // applications start concurrently. An application is not launched until the
+  // applications it depends on, according to |dependencies|, have been, if
+  // they are among |names|.
+  void StartInitialApplications(std::vector<std::string> names,
+                                const ApplicationDependencies& dependencies);
+
+  // The counters of every application that has been asked for, except those
+  // that never ran and were asked for too long ago (see |RetireName|).
+  const std::unordered_map<ApplicationId, ApplicationCounters>& counters()
+      const {
+    return counters_;
+  }
+
+  // Whether an instance of |id| is running.
+  bool IsRunning(ApplicationId id) const {
+    return !!table_.GetApplication(id);
+  }
+
+  // Calls |callback| with the id of each application that terminates, once
+  // |IsRunning| no longer reports it.
+  void set_application_stopped_callback(
+      std::function<void(ApplicationId)> callback) {
+    application_stopped_callback_ = std::move(callback);
+  }
+
+  // The memory committed to the process of |id|, or zero if it is not running
+  // or has no process of its own.
+  uint64_t GetMemoryUsage(ApplicationId id) const;
+
+  const LaunchTracer& launch_tracer() const { return launch_tracer_; }
+
+  // Connects to |tracing_app| and registers as a trace provider, so that the
+  // timelines of application launches are included in traces.
+  void RegisterWithTracing(const std::string& tracing_app);
+
+  // Returns a summary of how long recent launches took (see |LaunchTracer|).
+  std::string GetLaunchSummary() const { return launch_tracer_.GetSummary(); }
+
+  // Starts recording which applications each application connects to soon
+  // after it is launched, in the profile at |profile_path|. Once an
+  // application has shown a habit, the applications it connects to are
+  // started along with it, concurrently, rather than as its connections come
+  // in. Those that still have had no connection some time after starting are
+  // asked to quit, whether or not there is a reaping policy.
+  void EnablePrelaunching(const std::string& profile_path);
+
+  // Starts asking idle applications to quit according to |policy|, which
+  // replaces any earlier policy. The initial applications are always kept
+  // alive as well, since nothing would restart them.
+  void SetReapingPolicy(ReapingPolicy policy);
+
+  // The pool on which file contents are read, so that the message loop never
+  // waits on the disk.
+  WorkerPool* io_pool();
+
+  // Launchpads prepared ahead of time for native applications.
+  LaunchpadPool* launchpad_pool();
+
+  // Remembers how application files were classified. Used from the launch
+  // pool, which it outlives.
+  ResolvedApplicationCache* resolved_application_cache() {
+    return &resolved_application_cache_;
+  }
+
  private:
+  // Like the public overload, for a name that has already been interned.
+  ApplicationInstance* GetOrStartApplicationInstance(
+      ApplicationId id,
+      std::vector<std::string>* override_args);
+  // Like |GetOrStartApplicationInstance|, but launches on the launch pool.
+  // |callback| is called once the launch has completed.
+  void StartApplicationOnPool(const std::string& name,
+                              std::function<void(bool)> callback);
+  // Finds the configured arguments of the application with |canonical_name|.
+  bool FindArgsFor(const std::string& canonical_name,
+                   std::vector<std::string>* args) const;
+  void InitializeInstance(ApplicationInstance* instance,
+                          ApplicationId id,
+                          std::vector<std::string>* override_args);
+  // Starts the applications that |id| is likely to connect to, up to the limit
+  // on speculative launches in flight.
+  void Prelaunch(ApplicationId id);
+  // Asks the prelaunched application |name| to quit if nothing has connected
+  // to it.
+  void StopUnusedPrelaunch(const std::string& name);
+  // Counts a failed launch of |id|, and retires its name if it has never run.
+  void RecordLaunchFailure(ApplicationId id);
+  // Adds |id|, which is not running, to |retired_ids_|. Once it has been
+  // followed by enough others, its name is released and its counters are
+  // dropped, or for an instance-per-query application, added to those of the
+  // application.
+  void RetireName(ApplicationId id);
+  void ForgetName(ApplicationId id);
+  // Replaces the names in |policy| with their canonical forms.
+  void CanonicalizePolicy(ReapingPolicy* policy) const;
+  // Gives the reaper |reaping_policy_| with the initial applications kept
+  // alive, or stops it if that policy never reaps anything.
+  void UpdateReaper();
+  WorkerPool* GetLaunchPool();
+
+  ApplicationNames names_;
+  ApplicationId self_id_ = kInvalidApplicationId;
+  LaunchTracer launch_tracer_;
   ApplicationTable table_;
+  std::unordered_map<ApplicationId, ApplicationCounters> counters_;
+  // Names that are kept only for their counters, oldest first.
+  std::deque<ApplicationId> retired_ids_;
+  // Leases hold weak pointers to their pools, so the instances in |table_|
+  // may outlive these.
+  std::unordered_map<ApplicationId, std::unique_ptr<ContentHandlerPool>>
+      content_handler_pools_;
+  StatsService stats_service_;
   std::unordered_map<std::string, std::vector<std::string>> args_for_;
+  std::unique_ptr<StartupConfigImage> config_image_;
+  // The names in |config_image_| that are not canonical, by their canonical
+  // forms.
+  std::unordered_map<std::string, std::string> config_image_aliases_;
+  // Used on |launch_pool_|, so declared first to be destroyed after it.
+  ResolvedApplicationCache resolved_application_cache_;
+  // Refilled on |launch_pool_|, so declared first to be destroyed after it
+  // (see |LaunchpadPool|).
+  std::unique_ptr<LaunchpadPool> launchpad_pool_;
+  std::unique_ptr<WorkerPool> launch_pool_;
+  std::unique_ptr<WorkerPool> io_pool_;
+  // Saves on |io_pool_|, so declared after it to be destroyed first.
+  std::unique_ptr<ConnectionProfile> connection_profile_;
+  size_t num_speculative_launches_ = 0;
+  std::vector<std::unique_ptr<StartupScheduler>> startup_schedulers_;
+  // The canonical names of the current initial applications. Kept apart from
+  // |reaping_policy_|, which is the policy as configured.
+  std::unordered_set<std::string> initial_apps_;
+  ReapingPolicy reaping_policy_;
+  std::unique_ptr<ApplicationReaper> reaper_;
+  std::function<void(ApplicationId)> application_stopped_callback_;
+
+  ftl::WeakPtrFactory<ApplicationManager> weak_factory_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationManager);
 };
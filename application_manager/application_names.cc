@@ -0,0 +1,149 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/application_names.h"
+
+#include <utility>
+
+#include "lib/ftl/logging.h"
+
+namespace mojo {
+namespace {
+
+// These must agree with how application_launcher.cc resolves names.
+constexpr char kMojoAppUriPrefix[] = "file:///system/apps/";
+constexpr size_t kMojoAppUriPrefixLength = sizeof(kMojoAppUriPrefix) - 1;
+constexpr char kMojoScheme[] = "mojo:";
+constexpr size_t kMojoSchemeLength = sizeof(kMojoScheme) - 1;
+constexpr char kFileUriPrefix[] = "file://";
+constexpr size_t kFileUriPrefixLength = sizeof(kFileUriPrefix) - 1;
+
+constexpr size_t kMaxRawIds = 1024;
+
+}  // namespace
+
+ApplicationNames::ApplicationNames() = default;
+
+ApplicationNames::~ApplicationNames() = default;
+
+void ApplicationNames::set_instance_per_query(
+    std::unordered_set<std::string> names) {
+  FTL_DCHECK(names_.empty());
+  instance_per_query_ = std::move(names);
+}
+
+// static
+bool ApplicationNames::IsLaunchable(const std::string& name) {
+  return name.compare(0, kMojoSchemeLength, kMojoScheme) == 0 ||
+         name.compare(0, kFileUriPrefixLength, kFileUriPrefix) == 0;
+}
+
+std::string ApplicationNames::Canonicalize(const std::string& name) const {
+  std::string canonical;
+  if (name.compare(0, kMojoAppUriPrefixLength, kMojoAppUriPrefix) == 0) {
+    canonical = kMojoScheme + name.substr(kMojoAppUriPrefixLength);
+  } else {
+    canonical = name;
+  }
+
+  if (canonical.compare(0, kMojoSchemeLength, kMojoScheme) == 0) {
+    size_t query_pos = canonical.find('?', kMojoSchemeLength);
+    if (query_pos != std::string::npos &&
+        !instance_per_query_.count(canonical.substr(0, query_pos)))
+      canonical.resize(query_pos);
+  }
+  return canonical;
+}
+
+ApplicationId ApplicationNames::Intern(const std::string& name) {
+  auto raw_it = raw_ids_.find(name);
+  if (raw_it != raw_ids_.end())
+    return raw_it->second;
+
+  std::string canonical = Canonicalize(name);
+  ApplicationId id = kInvalidApplicationId;
+  auto it = ids_.find(canonical);
+  if (it != ids_.end()) {
+    id = it->second;
+  } else if (!free_ids_.empty()) {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+    names_[id - 1] = canonical;
+    ids_.emplace(std::move(canonical), id);
+  } else {
+    names_.push_back(canonical);
+    id = static_cast<ApplicationId>(names_.size());
+    ids_.emplace(std::move(canonical), id);
+  }
+
+  if (raw_ids_.size() >= kMaxRawIds)
+    raw_ids_.clear();
+  raw_ids_.emplace(name, id);
+  return id;
+}
+
+ApplicationId ApplicationNames::Find(const std::string& name) const {
+  auto raw_it = raw_ids_.find(name);
+  if (raw_it != raw_ids_.end())
+    return raw_it->second;
+  auto it = ids_.find(Canonicalize(name));
+  return it != ids_.end() ? it->second : kInvalidApplicationId;
+}
+
+void ApplicationNames::Release(ApplicationId id) {
+  FTL_DCHECK(!replica_bases_.count(id));
+  std::string& name = names_[id - 1];
+  FTL_DCHECK(ids_.count(name) && ids_[name] == id);
+  ids_.erase(name);
+  for (auto it = raw_ids_.begin(); it != raw_ids_.end();) {
+    if (it->second == id)
+      it = raw_ids_.erase(it);
+    else
+      ++it;
+  }
+  name.clear();
+  free_ids_.push_back(id);
+}
+
+bool ApplicationNames::IsInstancePerQuery(ApplicationId id) const {
+  // Canonical names only keep the query of instance-per-query applications,
+  // and replicas are not interned under their names.
+  const std::string& name = GetName(id);
+  return !replica_bases_.count(id) &&
+         name.compare(0, kMojoSchemeLength, kMojoScheme) == 0 &&
+         name.find('?', kMojoSchemeLength) != std::string::npos;
+}
+
+ApplicationId ApplicationNames::InternReplica(ApplicationId id,
+                                             size_t replica) {
+  if (replica == 0)
+    return id;
+  // The name of an instance-per-query application may have a query already.
+  const std::string& base = GetName(id);
+  std::string name = base +
+                     (base.find('?') != std::string::npos ? "&" : "?") +
+                     "replica=" + std::to_string(replica);
+  // Kept apart from |ids_|, so that |Intern| never returns a replica, even for
+  // an instance-per-query application whose canonical names keep the query.
+  auto it = replica_ids_.find(name);
+  if (it != replica_ids_.end())
+    return it->second;
+  names_.push_back(name);
+  ApplicationId replica_id = static_cast<ApplicationId>(names_.size());
+  replica_ids_.emplace(std::move(name), replica_id);
+  replica_bases_.emplace(replica_id, id);
+  return replica_id;
+}
+
+const std::string& ApplicationNames::GetName(ApplicationId id) const {
+  FTL_DCHECK(id != kInvalidApplicationId && id <= names_.size());
+  return names_[id - 1];
+}
+
+const std::string& ApplicationNames::GetBaseName(ApplicationId id) const {
+  auto it = replica_bases_.find(id);
+  return GetName(it != replica_bases_.end() ? it->second : id);
+}
+
+}  // namespace mojo
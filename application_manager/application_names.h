@@ -0,0 +1,109 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_APPLICATION_NAMES_H_
+#define MOJO_APPLICATION_MANAGER_APPLICATION_NAMES_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+
+namespace mojo {
+
+// A compact identity for an application, standing for its canonical name.
+using ApplicationId = uint32_t;
+
+constexpr ApplicationId kInvalidApplicationId = 0u;
+
+// Interns application names into |ApplicationId|s. Names that would launch the
+// same application are given the same id:
+//
+//  * "file:///system/apps/foo" is the same application as "mojo:foo".
+//  * The query of a "mojo:" name (e.g., "?x=1" in "mojo:foo?x=1") does not
+//    affect which binary is launched, so by default it is not part of the
+//    identity either. Applications listed with |set_instance_per_query| get
+//    a separate instance for each query instead.
+//
+// Only names that the launcher can resolve (see |IsLaunchable|) should be
+// interned. A name is kept until it is released, after which its id may be
+// given to another name, so a name must only be released once nothing refers
+// to its id.
+class ApplicationNames {
+ public:
+  ApplicationNames();
+  ~ApplicationNames();
+
+  // Sets the canonical names of the applications whose query is part of their
+  // identity. Must be called before any names are interned.
+  void set_instance_per_query(std::unordered_set<std::string> names);
+
+  // Whether |name| has a scheme that the launcher resolves to a file, so that
+  // it may name an application at all.
+  static bool IsLaunchable(const std::string& name);
+
+  // Returns the canonical form of |name|, as described above.
+  std::string Canonicalize(const std::string& name) const;
+
+  // Returns the id of the canonical form of |name|, assigning one if needed.
+  ApplicationId Intern(const std::string& name);
+
+  // Returns the id of the canonical form of |name|, or |kInvalidApplicationId|
+  // if it has not been interned.
+  ApplicationId Find(const std::string& name) const;
+
+  // Forgets the name that |id| stands for, and makes |id| available to the
+  // next name that is interned. |id| must not be a content handler replica or
+  // have replicas.
+  void Release(ApplicationId id);
+
+  // Whether |id| is an instance of an instance-per-query application, which
+  // has a name of its own for each query.
+  bool IsInstancePerQuery(ApplicationId id) const;
+
+  // Returns the id of replica |replica| of the content handler |id| (see
+  // |ContentHandlerPool|). Replica 0 is |id| itself. The other replicas are
+  // named after |id| with a "replica" query parameter, which the launcher
+  // ignores, and |Intern| never returns their ids.
+  // Configuration for a replica is found under |GetBaseName|.
+  ApplicationId InternReplica(ApplicationId id, size_t replica);
+
+  // Returns the canonical name that |id| stands for. The reference stays valid
+  // for the lifetime of this object.
+  const std::string& GetName(ApplicationId id) const;
+
+  // Returns the name that policies for |id| are configured under: the name of
+  // the content handler that |id| is a replica of, or else |GetName(id)|.
+  const std::string& GetBaseName(ApplicationId id) const;
+
+ private:
+  std::unordered_set<std::string> instance_per_query_;
+
+  // Indexed by id - 1. A deque, so that references to the names stay valid as
+  // more are added.
+  std::deque<std::string> names_;
+  std::unordered_map<std::string, ApplicationId> ids_;
+  // Released ids, which are given out again before new ones.
+  std::vector<ApplicationId> free_ids_;
+  // The ids of the replicas other than replica 0, by name, and the id that
+  // each was interned from.
+  std::unordered_map<std::string, ApplicationId> replica_ids_;
+  std::unordered_map<ApplicationId, ApplicationId> replica_bases_;
+
+  // The ids of names as they were given to |Intern|, so that repeated lookups
+  // of the same name skip canonicalization. Only a cache, so it is cleared
+  // when it grows too large.
+  std::unordered_map<std::string, ApplicationId> raw_ids_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationNames);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_APPLICATION_NAMES_H_
@@ -0,0 +1,190 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/application_reaper.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "mojo/application_manager/application_table.h"
+#include "mojo/application_manager/process_memory.h"
+
+namespace mojo {
+namespace {
+
+// How often the applications are checked. Idle timeouts are only honored to
+// within this much.
+constexpr ftl::TimeDelta kReapInterval = ftl::TimeDelta::FromSeconds(10);
+
+}  // namespace
+
+ReapingPolicy::ReapingPolicy() = default;
+
+ReapingPolicy::ReapingPolicy(const ReapingPolicy& other) = default;
+
+ReapingPolicy::ReapingPolicy(ReapingPolicy&& other) = default;
+
+ReapingPolicy& ReapingPolicy::operator=(const ReapingPolicy& other) = default;
+
+ReapingPolicy& ReapingPolicy::operator=(ReapingPolicy&& other) = default;
+
+ReapingPolicy::~ReapingPolicy() = default;
+
+bool ReapingPolicy::is_enabled() const {
+  if (memory_budget || default_idle_timeout > ftl::TimeDelta::Zero())
+    return true;
+  for (const auto& entry : idle_timeouts) {
+    if (entry.second > ftl::TimeDelta::Zero())
+      return true;
+  }
+  return false;
+}
+
+ftl::TimeDelta ReapingPolicy::GetIdleTimeout(const std::string& name) const {
+  if (keep_alive.count(name))
+    return ftl::TimeDelta::Zero();
+  auto it = idle_timeouts.find(name);
+  if (it != idle_timeouts.end())
+    return it->second;
+  return default_idle_timeout;
+}
+
+ApplicationReaper::ApplicationReaper(ApplicationTable* table,
+                                     ReapingPolicy policy)
+    : table_(table), policy_(std::move(policy)), weak_factory_(this) {
+  FTL_DCHECK(table_);
+  ScheduleReap();
+}
+
+ApplicationReaper::~ApplicationReaper() = default;
+
+void ApplicationReaper::Reap() {
+  std::unordered_set<ApplicationId> busy_content_handlers =
+      GetBusyContentHandlers();
+  std::vector<Candidate> candidates;
+  uint64_t total_memory_usage = 0u;
+  table_->ForEachApplication([this, &busy_content_handlers, &candidates,
+                              &total_memory_usage](
+      ApplicationId id, ApplicationInstance* instance) {
+    if (instance->quit_requested())
+      return;
+    // Reading a process's memory usage is a syscall, so it is only done when
+    // there is a budget to check it against.
+    uint64_t memory_usage = policy_.memory_budget
+                                ? GetProcessMemoryUsage(instance->process())
+                                : 0u;
+    total_memory_usage += memory_usage;
+    if (!instance->is_initialized())
+      return;
+    Candidate candidate;
+    candidate.id = id;
+    candidate.base_name = table_->names()->GetBaseName(id);
+    candidate.last_activity = instance->last_activity();
+    candidate.memory_usage = memory_usage;
+    candidate.is_busy_content_handler = busy_content_handlers.count(id) != 0;
+    candidates.push_back(std::move(candidate));
+  });
+
+  std::vector<ApplicationId> idle =
+      SelectIdle(policy_, candidates, ftl::TimePoint::Now());
+  for (ApplicationId id : idle) {
+    ApplicationInstance* instance = table_->GetApplication(id);
+    FTL_DLOG(INFO) << "Asking idle application to quit: ""
+                   << instance->name() << """;
+    instance->RequestQuit();
+  }
+  if (!policy_.memory_budget)
+    return;
+
+  // The idle applications are on their way out, so their memory does not
+  // count against the budget.
+  std::unordered_set<ApplicationId> idle_set(idle.begin(), idle.end());
+  candidates.erase(
+      std::remove_if(candidates.begin(), candidates.end(),
+                     [&idle_set, &total_memory_usage](
+                         const Candidate& candidate) {
+                       if (!idle_set.count(candidate.id))
+                         return false;
+                       total_memory_usage -= candidate.memory_usage;
+                       return true;
+                     }),
+      candidates.end());
+  for (ApplicationId id : SelectOverBudget(policy_, std::move(candidates),
+                                           total_memory_usage)) {
+    ApplicationInstance* instance = table_->GetApplication(id);
+    FTL_DLOG(INFO) << "Asking application to quit to stay within the memory "
+                   << "budget: \"" << instance->name() << "\"";
+    instance->RequestQuit();
+  }
+}
+
+// static
+std::vector<ApplicationId> ApplicationReaper::SelectIdle(
+    const ReapingPolicy& policy,
+    const std::vector<Candidate>& candidates,
+    ftl::TimePoint now) {
+  std::vector<ApplicationId> ids;
+  for (const auto& candidate : candidates) {
+    if (candidate.is_busy_content_handler)
+      continue;
+    ftl::TimeDelta timeout = policy.GetIdleTimeout(candidate.base_name);
+    if (timeout > ftl::TimeDelta::Zero() &&
+        now - candidate.last_activity >= timeout)
+      ids.push_back(candidate.id);
+  }
+  return ids;
+}
+
+// static
+std::vector<ApplicationId> ApplicationReaper::SelectOverBudget(
+    const ReapingPolicy& policy,
+    std::vector<Candidate> candidates,
+    uint64_t total_memory_usage) {
+  std::vector<ApplicationId> ids;
+  if (!policy.memory_budget || total_memory_usage <= policy.memory_budget)
+    return ids;
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) {
+              return a.last_activity < b.last_activity;
+            });
+  for (const auto& candidate : candidates) {
+    if (total_memory_usage <= policy.memory_budget)
+      break;
+    if (!candidate.memory_usage || candidate.is_busy_content_handler ||
+        policy.keep_alive.count(candidate.base_name))
+      continue;
+    ids.push_back(candidate.id);
+    total_memory_usage -= candidate.memory_usage;
+  }
+  return ids;
+}
+
+std::unordered_set<ApplicationId> ApplicationReaper::GetBusyContentHandlers() {
+  std::unordered_set<ApplicationId> ids;
+  table_->ForEachApplication([&ids](ApplicationId id,
+                                    ApplicationInstance* instance) {
+    if (instance->content_handler_id() != kInvalidApplicationId &&
+        !instance->quit_requested())
+      ids.insert(instance->content_handler_id());
+  });
+  return ids;
+}
+
+void ApplicationReaper::ScheduleReap() {
+  ftl::WeakPtr<ApplicationReaper> weak_this = weak_factory_.GetWeakPtr();
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this] {
+        if (!weak_this)
+          return;
+        weak_this->Reap();
+        weak_this->ScheduleReap();
+      },
+      kReapInterval);
+}
+
+}  // namespace mojo
@@ -0,0 +1,117 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_APPLICATION_REAPER_H_
+#define MOJO_APPLICATION_MANAGER_APPLICATION_REAPER_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+#include "mojo/application_manager/application_names.h"
+
+namespace mojo {
+class ApplicationTable;
+
+// When applications that are not being used should be asked to quit.
+struct ReapingPolicy {
+  ReapingPolicy();
+  ReapingPolicy(const ReapingPolicy& other);
+  ReapingPolicy(ReapingPolicy&& other);
+  ReapingPolicy& operator=(const ReapingPolicy& other);
+  ReapingPolicy& operator=(ReapingPolicy&& other);
+  ~ReapingPolicy();
+
+  // Whether this policy would ever ask an application to quit.
+  bool is_enabled() const;
+
+  // How long |name| may be idle (see |ApplicationReaper|) before it is asked
+  // to quit. Zero means forever.
+  ftl::TimeDelta GetIdleTimeout(const std::string& name) const;
+
+  // Applications are asked to quit after being idle this long, unless they
+  // have their own timeout. Zero means never.
+  ftl::TimeDelta default_idle_timeout;
+  std::unordered_map<std::string, ftl::TimeDelta> idle_timeouts;
+
+  // Applications that are never asked to quit.
+  std::unordered_set<std::string> keep_alive;
+
+  // When the applications together use more memory than this, the least
+  // recently used ones are asked to quit until they fit. Zero means no limit.
+  uint64_t memory_budget = 0;
+};
+
+// Asks idle applications to quit, following a |ReapingPolicy|. The
+// applications are checked periodically on the current message loop.
+//
+// An application is idle once it has gone a while without being given a
+// connection and without connecting to another application. A content handler
+// is never idle while applications it runs are alive.
+//
+// An application that has been asked to quit stays in the table until it
+// closes its pipe, but is not given any more connections (see
+// |ApplicationTable|).
+class ApplicationReaper {
+ public:
+  // What the reaper goes by when deciding whether to ask an application that
+  // has been initialized, and not yet asked to quit, to quit.
+  struct Candidate {
+    ApplicationId id = kInvalidApplicationId;
+    // The name the application's timeout and keep-alive are looked up by.
+    std::string base_name;
+    ftl::TimePoint last_activity;
+    // Zero if not known, or if there is no memory budget to check it against.
+    uint64_t memory_usage = 0u;
+    // Whether the application is a content handler running applications. It
+    // is in use as long as those applications are.
+    bool is_busy_content_handler = false;
+  };
+
+  ApplicationReaper(ApplicationTable* table, ReapingPolicy policy);
+  ~ApplicationReaper();
+
+  ReapingPolicy* policy() { return &policy_; }
+
+  // Checks the applications now. Called periodically.
+  void Reap();
+
+  // Returns the |candidates| that have been idle for longer than |policy|
+  // allows at |now|.
+  static std::vector<ApplicationId> SelectIdle(
+      const ReapingPolicy& policy,
+      const std::vector<Candidate>& candidates,
+      ftl::TimePoint now);
+
+  // Returns the least recently used |candidates| that must quit for the
+  // applications, which use |total_memory_usage| together, to fit within the
+  // memory budget of |policy|.
+  static std::vector<ApplicationId> SelectOverBudget(
+      const ReapingPolicy& policy,
+      std::vector<Candidate> candidates,
+      uint64_t total_memory_usage);
+
+ private:
+  void ScheduleReap();
+  // The content handlers that are running applications.
+  std::unordered_set<ApplicationId> GetBusyContentHandlers();
+
+  ApplicationTable* const table_;
+  ReapingPolicy policy_;
+
+  ftl::WeakPtrFactory<ApplicationReaper> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationReaper);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_APPLICATION_REAPER_H_
@@ -6,20 +6,23 @@
 
 #include <utility>
 
+#include "lib/ftl/logging.h"
+
 namespace mojo {
 
-ApplicationTable::ApplicationTable() {}
+ApplicationTable::ApplicationTable(const ApplicationNames* names)
+    : names_(names) {}
 
 ApplicationTable::~ApplicationTable() {}
 
 ApplicationInstance* ApplicationTable::GetOrStartApplication(
     ApplicationManager* manager,
-    std::string name) {
-  auto result = map_.emplace(std::move(name), nullptr);
+    ApplicationId id) {
+  auto result = FindOrInsert(id);
   auto it = result.first;
   if (result.second) {
     auto application = std::make_unique<ApplicationInstance>();
-    if (!application->Start(manager, it->first)) {
+    if (!application->Start(manager, names_->GetName(id))) {
       map_.erase(it);
       return nullptr;
     }
@@ -28,8 +31,55 @@ ApplicationInstance* ApplicationTable::GetOrStartApplication(
   return it->second.get();
 }
 
-void ApplicationTable::StopApplication(const std::string& name) {
-  map_.erase(name);
+ApplicationInstance* ApplicationTable::GetOrStartApplicationOnPool(
+    ApplicationManager* manager,
+    ApplicationId id,
+    WorkerPool* pool,
+    std::function<void(bool)> callback) {
+  auto result = FindOrInsert(id);
+  auto it = result.first;
+  if (!result.second) {
+    callback(!!it->second);
+    return it->second.get();
+  }
+  it->second = std::make_unique<ApplicationInstance>();
+  it->second->StartOnPool(manager, names_->GetName(id), pool,
+                          std::move(callback));
+  return it->second.get();
+}
+
+void ApplicationTable::StopApplication(ApplicationId id) {
+  map_.erase(id);
+}
+
+ApplicationInstance* ApplicationTable::GetApplication(ApplicationId id) const {
+  auto it = map_.find(id);
+  return it != map_.end() ? it->second.get() : nullptr;
+}
+
+void ApplicationTable::ForEachApplication(
+    const std::function<void(ApplicationId, ApplicationInstance*)>&
+        callback) {
+  for (const auto& entry : map_) {
+    // An entry is empty while its application is being started.
+    if (entry.second)
+      callback(entry.first, entry.second.get());
+  }
+}
+
+std::pair<ApplicationTable::AppMap::iterator, bool>
+ApplicationTable::FindOrInsert(ApplicationId id) {
+  auto result = map_.emplace(id, nullptr);
+  // The entry is empty if |GetOrStartApplication| is still starting the
+  // application, in which case it is left to finish.
+  if (!result.second && result.first->second &&
+      result.first->second->quit_requested()) {
+    FTL_DLOG(INFO) << "Restarting application that was asked to quit: \""
+                   << names_->GetName(id) << "\"";
+    result.first->second.reset();
+    result.second = true;
+  }
+  return result;
 }
 
 }  // namespace mojo
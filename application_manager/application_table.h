@@ -5,30 +5,68 @@
 #ifndef MOJO_APPLICATION_MANAGER_APPLICATION_TABLE_H_
 #define MOJO_APPLICATION_MANAGER_APPLICATION_TABLE_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
 
 #include "mojo/application_manager/application_instance.h"
+#include "mojo/application_manager/application_names.h"
 
 namespace mojo {
 class ApplicationManager;
+class WorkerPool;
 
+// The running applications, by name. An application that has been asked to
+// quit is replaced by a new instance the next time it is needed, rather than
+// being handed connections that it might drop.
 class ApplicationTable {
  public:
-  ApplicationTable();
+  // |names| must outlive this object.
+  explicit ApplicationTable(const ApplicationNames* names);
   ~ApplicationTable();
 
+  // Returns null if the application could not be started, or if this is
+  // called again for |id| while the application is being started.
   ApplicationInstance* GetOrStartApplication(ApplicationManager* manager,
-                                             std::string name);
-  void StopApplication(const std::string& name);
+                                             ApplicationId id);
+
+  // Like |GetOrStartApplication|, but a new application is launched on |pool|
+  // (see |ApplicationInstance::StartOnPool|), so this only returns null if
+  // |GetOrStartApplication| is starting the application right now. |callback|
+  // is called with whether the launch succeeded once it has completed, or
+  // right away if the application was already running or being started.
+  ApplicationInstance* GetOrStartApplicationOnPool(
+      ApplicationManager* manager,
+      ApplicationId id,
+      WorkerPool* pool,
+      std::function<void(bool)> callback);
+
+  void StopApplication(ApplicationId id);
+
+  // Returns the running instance of |id|, or null if there is none.
+  ApplicationInstance* GetApplication(ApplicationId id) const;
+
+  // Whether |id| is running or being started.
+  bool Contains(ApplicationId id) const { return !!map_.count(id); }
+
+  void ForEachApplication(
+      const std::function<void(ApplicationId, ApplicationInstance*)>&
+          callback);
 
   bool is_empty() const { return map_.empty(); }
 
+  const ApplicationNames* names() const { return names_; }
+
  private:
   using AppMap =
-      std::unordered_map<std::string, std::unique_ptr<ApplicationInstance>>;
+      std::unordered_map<ApplicationId, std::unique_ptr<ApplicationInstance>>;
+
+  // Returns the entry for |id|, after removing any instance that has been
+  // asked to quit. The second field is true if the entry is new.
+  std::pair<AppMap::iterator, bool> FindOrInsert(ApplicationId id);
 
+  const ApplicationNames* const names_;
   AppMap map_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationTable);
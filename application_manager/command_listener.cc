@@ -4,18 +4,42 @@
 
 #include "mojo/application_manager/command_listener.h"
 
+#include <mojo/system/message_pipe_ext.h>
+#include <stdio.h>
+
 #include <utility>
 
 #include "lib/ftl/logging.h"
 #include "lib/ftl/strings/split_string.h"
 #include "mojo/application_manager/application_manager.h"
+#include "mojo/public/cpp/environment/environment.h"
+#include "mojo/public/cpp/system/wait.h"
 
 namespace mojo {
+namespace {
+
+// Application names always have a scheme, so a command without a colon
+// cannot be mistaken for one.
+constexpr char kLaunchSummaryCommand[] = "launch-summary";
+constexpr char kReloadConfigCommand[] = "reload-config";
+
+// Messages handled per wakeup before yielding to the rest of the message
+// loop, so that a flood of commands cannot starve the applications being
+// started.
+constexpr size_t kMaxMessagesPerWakeup = 64;
+
+// How long a forwarded command may take to run before its sender gives up.
+constexpr MojoDeadline kForwardTimeoutMicroseconds = 10 * 1000 * 1000;
+
+}  // namespace
 
 CommandListener::CommandListener(ApplicationManager* manager)
-    : manager_(manager) {}
+    : manager_(manager), waiter_(Environment::GetDefaultAsyncWaiter()) {}
 
-CommandListener::~CommandListener() = default;
+CommandListener::~CommandListener() {
+  if (wait_id_)
+    waiter_->CancelWait(wait_id_);
+}
 
 void CommandListener::StartListening(ScopedMessagePipeHandle handle) {
   FTL_DCHECK(handle.is_valid());
@@ -24,39 +48,154 @@ void CommandListener::StartListening(ScopedMessagePipeHandle handle) {
   WaitForCommand();
 }
 
+// static
+void CommandListener::OnHandleReady(void* closure, MojoResult result) {
+  CommandListener* listener = static_cast<CommandListener*>(closure);
+  listener->wait_id_ = 0;
+  if (result != MOJO_RESULT_OK) {
+    listener->StopListening(result);
+    return;
+  }
+  listener->ReadCommands();
+}
+
+void CommandListener::StopListening(MojoResult result) {
+  // Usually the sender has closed its end, after which no command can come.
+  if (result != MOJO_SYSTEM_RESULT_FAILED_PRECONDITION)
+    FTL_LOG(WARNING) << "Stopped listening for commands: error " << result;
+  handle_.reset();
+}
+
 void CommandListener::WaitForCommand() {
-  waiter_.reset(new AsyncWaiter(handle_.get(), MOJO_HANDLE_SIGNAL_READABLE,
-                                [this](MojoResult result) {
-                                  if (result == MOJO_RESULT_OK)
-                                    ReadCommand();
-                                }));
-}
-
-void CommandListener::ReadCommand() {
-  uint32_t num_bytes = 0;
-  MojoResult result = ReadMessageRaw(handle_.get(), nullptr, &num_bytes,
-                                     nullptr, 0, MOJO_READ_MESSAGE_FLAG_NONE);
-  if (result == MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED) {
-    std::vector<char> bytes(num_bytes);
-    result = ReadMessageRaw(handle_.get(), &bytes[0], &num_bytes, nullptr, 0,
-                            MOJO_READ_MESSAGE_FLAG_NONE);
-    FTL_CHECK(result == MOJO_RESULT_OK);
-    ExecuteCommand(std::string(bytes.data(), bytes.size()));
+  FTL_DCHECK(!wait_id_);
+  wait_id_ = waiter_->AsyncWait(handle_.get().value(),
+                                MOJO_HANDLE_SIGNAL_READABLE,
+                                MOJO_DEADLINE_INDEFINITE,
+                                &CommandListener::OnHandleReady, this);
+}
+
+void CommandListener::ReadCommands() {
+  if (buffer_.empty())
+    buffer_.resize(MOJO_MESSAGE_MAX_NUM_BYTES);
+  for (size_t i = 0; i < kMaxMessagesPerWakeup; ++i) {
+    uint32_t num_bytes = static_cast<uint32_t>(buffer_.size());
+    const MojoHandle* handles = nullptr;
+    uint32_t num_handles = 0;
+    MojoResult result = MojoReadMessageWithReservedHandles(
+        handle_.get().value(), buffer_.data(), &num_bytes, &handles,
+        &num_handles, MOJO_READ_MESSAGE_FLAG_NONE);
+    if (result == MOJO_SYSTEM_RESULT_SHOULD_WAIT)
+      break;
+    if (result != MOJO_RESULT_OK) {
+      StopListening(result);
+      return;
+    }
+    // The only handle a command carries is where to send its result. The
+    // handles are taken out of the reserved array before anything else can
+    // read a message on this thread.
+    ScopedMessagePipeHandle reply;
+    if (num_handles == 1) {
+      reply.reset(MessagePipeHandle(handles[0]));
+    } else {
+      for (uint32_t j = 0; j < num_handles; ++j)
+        MojoClose(handles[j]);
+    }
+    // Nothing else reads into |buffer_|: this listener does not wait on its
+    // handle again until the commands have run.
+    bool succeeded =
+        ExecuteCommands(ftl::StringView(buffer_.data(), num_bytes));
+    if (reply.is_valid()) {
+      const uint8_t result_byte = succeeded ? 1 : 0;
+      WriteMessageRaw(reply.get(), &result_byte, sizeof(result_byte), nullptr,
+                      0, MOJO_WRITE_MESSAGE_FLAG_NONE);
+    }
   }
 
   WaitForCommand();
 }
 
-void CommandListener::ExecuteCommand(std::string command) {
+bool CommandListener::ExecuteCommands(ftl::StringView commands) {
+  bool succeeded = true;
+  for (ftl::StringView command : ftl::SplitString(
+           commands, "\n", ftl::kTrimWhitespace, ftl::kSplitWantNonEmpty)) {
+    if (!ExecuteCommand(command))
+      succeeded = false;
+  }
+  return succeeded;
+}
+
+bool CommandListener::ExecuteCommand(ftl::StringView command) {
   // TODO(jeffbrown): We should probably leave tokenization up to the shell
   // which is invoking the command listener.
-  std::vector<std::string> args = ftl::SplitStringCopy(
-      command, " ", ftl::kTrimWhitespace, ftl::kSplitWantNonEmpty);
-  if (args.size() > 0) {
-    std::string application_name = args[0];
-    args.erase(args.begin());
-    manager_->GetOrStartApplicationInstance(application_name, &args);
+  return RunCommand(ftl::SplitString(command, " ", ftl::kTrimWhitespace,
+                                     ftl::kSplitWantNonEmpty));
+}
+
+bool CommandListener::RunCommand(const std::vector<ftl::StringView>& args) {
+  if (args.empty())
+    return true;
+  if (args.size() == 1 && args[0] == kLaunchSummaryCommand) {
+    fprintf(stderr, "%s", manager_->GetLaunchSummary().c_str());
+    return true;
+  }
+  if (args.size() == 1 && args[0] == kReloadConfigCommand) {
+    if (!reload_config_callback_)
+      return false;
+    reload_config_callback_();
+    return true;
   }
+  // Only the arguments of a launch are copied, since the application keeps
+  // them.
+  std::vector<std::string> application_args;
+  application_args.reserve(args.size() - 1);
+  for (auto it = args.begin() + 1; it != args.end(); ++it)
+    application_args.push_back(it->ToString());
+  return !!manager_->GetOrStartApplicationInstance(args[0].ToString(),
+                                                   &application_args);
+}
+
+bool ForwardCommand(MessagePipeHandle listener,
+                    const std::vector<std::string>& args,
+                    bool* succeeded) {
+  // The listener splits commands on whitespace, so arguments that contain any
+  // cannot be sent intact.
+  std::string command;
+  for (const std::string& arg : args) {
+    if (arg.empty() || arg.find_first_of(" \t\r\n") != std::string::npos) {
+      fprintf(stderr,
+              "application_manager: Cannot forward the argument \"%s\"\n",
+              arg.c_str());
+      *succeeded = false;
+      return true;
+    }
+    if (!command.empty())
+      command.push_back(' ');
+    command.append(arg);
+  }
+  command.push_back('\n');
+
+  MessagePipe reply_pipe;
+  MojoHandle reply_handle = reply_pipe.handle1.release().value();
+  if (WriteMessageRaw(listener, command.data(),
+                      static_cast<uint32_t>(command.size()), &reply_handle, 1,
+                      MOJO_WRITE_MESSAGE_FLAG_NONE) != MOJO_RESULT_OK) {
+    // Nothing is listening any more; the handle was not transferred.
+    MojoClose(reply_handle);
+    return false;
+  }
+
+  if (Wait(reply_pipe.handle0.get(), MOJO_HANDLE_SIGNAL_READABLE,
+           kForwardTimeoutMicroseconds, nullptr) != MOJO_RESULT_OK)
+    return false;
+  uint8_t result_byte = 0;
+  uint32_t num_bytes = sizeof(result_byte);
+  if (ReadMessageRaw(reply_pipe.handle0.get(), &result_byte, &num_bytes,
+                     nullptr, nullptr,
+                     MOJO_READ_MESSAGE_FLAG_NONE) != MOJO_RESULT_OK ||
+      num_bytes != sizeof(result_byte))
+    return false;
+  *succeeded = result_byte == 1;
+  return true;
 }
 
 }  // namespace mojo
@@ -7,11 +7,12 @@
 
 #include <mojo/environment/async_waiter.h>
 
-#include <memory>
+#include <functional>
+#include <string>
+#include <vector>
 
 #include "lib/ftl/macros.h"
-#include "mojo/public/cpp/environment/async_waiter.h"
-#include "mojo/public/cpp/environment/environment.h"
+#include "lib/ftl/strings/string_view.h"
 #include "mojo/public/cpp/system/message_pipe.h"
 
 namespace mojo {
@@ -20,6 +21,14 @@ class ApplicationManager;
 // This class listens on the given handle for commands to drive the application
 // manager. For example, mxsh sends commands the user types that begin with
 // "mojo:" to this class to run the cooresponding applications.
+//
+// A message may carry several commands, one per line, so that scripts can
+// send many commands at once. All the messages that are waiting are handled
+// each time the handle becomes readable.
+//
+// A message may also carry a single message pipe handle, on which a single
+// byte is written once its commands have run: 1 if they all succeeded, 0
+// otherwise. Other handles are closed.
 class CommandListener {
  public:
   explicit CommandListener(ApplicationManager* manager);
@@ -27,18 +36,46 @@ class CommandListener {
 
   void StartListening(ScopedMessagePipeHandle handle);
 
+  // Called to run the "reload-config" command, which succeeds once the reload
+  // has been started. The config is read off the message loop, so whether it
+  // could be applied is only logged.
+  void set_reload_config_callback(std::function<void()> callback) {
+    reload_config_callback_ = std::move(callback);
+  }
+
  private:
+  static void OnHandleReady(void* closure, MojoResult result);
+
+  // Gives up on the handle after a failed wait or read with |result|.
+  void StopListening(MojoResult result);
   void WaitForCommand();
-  void ReadCommand();
-  void ExecuteCommand(std::string command);
+  void ReadCommands();
+  // Returns whether all the commands succeeded.
+  bool ExecuteCommands(ftl::StringView commands);
+  bool ExecuteCommand(ftl::StringView command);
+  bool RunCommand(const std::vector<ftl::StringView>& args);
 
   ApplicationManager* const manager_;
   ScopedMessagePipeHandle handle_;
-  std::unique_ptr<AsyncWaiter> waiter_;
+  const MojoAsyncWaiter* const waiter_;
+  MojoAsyncWaitID wait_id_ = 0;
+  // Messages are read straight into this buffer, which is allocated on first
+  // use and reused, and commands are tokenized where they lie in it.
+  std::vector<char> buffer_;
+  std::function<void()> reload_config_callback_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(CommandListener);
 };
 
+// Sends |args| as a single command over |listener|, the client end of a
+// handle that a CommandListener serves, and waits for the reply. Returns
+// whether one replied in time, in which case |*succeeded| is set to whether
+// the command succeeded. An empty command only checks that the listener is
+// there.
+bool ForwardCommand(MessagePipeHandle listener,
+                    const std::vector<std::string>& args,
+                    bool* succeeded);
+
 }  // namespace mojo
 
 #endif  // MOJO_APPLICATION_MANAGER_COMMAND_LISTENER_H_
@@ -0,0 +1,151 @@
+#!/usr/bin/env python
+# Copyright 2016 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Compiles a startup config into the image read by startup_config_image.cc.
+
+The layout is described in startup_config_image.h and must be kept in sync
+with it.
+"""
+
+import json
+import os
+import struct
+import sys
+
+MAGIC = b"MOJOSCFG"
+VERSION = 2
+
+FNV_OFFSET_BASIS = 2166136261
+FNV_PRIME = 16777619
+
+# Keys whose values can be large and are laid out in the image. Everything
+# else is kept as JSON.
+INITIAL_APPS = "initial-apps"
+ARGS_FOR = "args-for"
+DEPENDS_ON = "depends-on"
+
+HEADER_FORMAT = "<8s15I"
+STRING_REF_FORMAT = "<2I"
+
+try:
+    STRING_TYPES = (str, unicode)
+except NameError:
+    STRING_TYPES = (str,)
+
+
+class StringTable(object):
+    def __init__(self):
+        self.data = bytearray()
+        self.offsets = {}
+
+    def add(self, string):
+        encoded = string.encode("utf-8")
+        if encoded not in self.offsets:
+            self.offsets[encoded] = len(self.data)
+            self.data += encoded
+        return struct.pack(STRING_REF_FORMAT, self.offsets[encoded],
+                           len(encoded))
+
+
+def hash_config(data):
+    """FNV-1a over the bytes of the config, as in startup_config_image.cc."""
+    result = FNV_OFFSET_BASIS
+    for byte in bytearray(data):
+        result = ((result ^ byte) * FNV_PRIME) & 0xffffffff
+    return result
+
+
+def fail(message):
+    sys.stderr.write("compile_startup_config: %s\n" % message)
+    sys.exit(1)
+
+
+def check_string_list(value, key):
+    if not isinstance(value, list) or not all(
+            isinstance(item, STRING_TYPES) for item in value):
+        fail("\"%s\" must be a list of strings" % key)
+
+
+def compile_config(config, config_hash):
+    if not isinstance(config, dict):
+        fail("the config must be an object")
+    strings = StringTable()
+
+    initial_apps = config.pop(INITIAL_APPS, [])
+    check_string_list(initial_apps, INITIAL_APPS)
+
+    list_items = []
+
+    def compile_list_map(key):
+        value = config.pop(key, {})
+        if not isinstance(value, dict):
+            fail("\"%s\" must be an object" % key)
+        entries = []
+        # Sorted by their UTF-8 bytes, so the image can be binary searched.
+        for name in sorted(value, key=lambda name: name.encode("utf-8")):
+            check_string_list(value[name], "%s\" of \"%s" % (key, name))
+            name_ref = strings.add(name)
+            entries.append(name_ref + struct.pack(
+                STRING_REF_FORMAT, len(list_items), len(value[name])))
+            list_items.extend(strings.add(item) for item in value[name])
+        return entries
+
+    args_for = compile_list_map(ARGS_FOR)
+    depends_on = compile_list_map(DEPENDS_ON)
+    initial_app_refs = [strings.add(name) for name in initial_apps]
+    options = json.dumps(config, separators=(",", ":"), sort_keys=True)
+    options_ref = strings.add(options)
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    sections = [
+        b"".join(initial_app_refs),
+        b"".join(args_for),
+        b"".join(depends_on),
+        b"".join(list_items),
+        bytes(strings.data),
+    ]
+    offsets = []
+    offset = header_size
+    for section in sections:
+        offsets.append(offset)
+        # Every section starts on a 4-byte boundary.
+        offset += (len(section) + 3) & ~3
+    options_offset, options_length = struct.unpack(STRING_REF_FORMAT,
+                                                   options_ref)
+    header = struct.pack(
+        HEADER_FORMAT, MAGIC, VERSION, offset,
+        offsets[0], len(initial_app_refs),
+        offsets[1], len(args_for),
+        offsets[2], len(depends_on),
+        offsets[3], len(list_items),
+        offsets[4], len(strings.data),
+        options_offset, options_length, config_hash)
+    image = bytearray(header)
+    for section in sections:
+        image += section
+        image += b"\0" * (((len(section) + 3) & ~3) - len(section))
+    assert len(image) == offset
+    return bytes(image)
+
+
+def main():
+    if len(sys.argv) != 3:
+        fail("usage: compile_startup_config.py <startup.config> <output>")
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    try:
+        config = json.loads(data.decode("utf-8"))
+    except ValueError as error:
+        fail("%s: %s" % (sys.argv[1], error))
+    image = compile_config(config, hash_config(data))
+    out_dir = os.path.dirname(sys.argv[2])
+    if out_dir and not os.path.exists(out_dir):
+        os.makedirs(out_dir)
+    with open(sys.argv[2], "wb") as f:
+        f.write(image)
+
+
+if __name__ == "__main__":
+    main()
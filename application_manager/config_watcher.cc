@@ -0,0 +1,160 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/config_watcher.h"
+
+#include <sys/stat.h>
+
+#include <memory>
+#include <utility>
+
+#include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "mojo/application_manager/startup_config.h"
+#include "mojo/application_manager/startup_config_image.h"
+#include "mojo/application_manager/worker_pool.h"
+
+namespace mojo {
+namespace {
+
+// How often the config is checked for changes. A stat of two files, on the
+// I/O pool, so cheap enough to do often.
+constexpr ftl::TimeDelta kCheckInterval = ftl::TimeDelta::FromSeconds(5);
+
+}  // namespace
+
+bool ConfigWatcher::FileVersion::operator==(const FileVersion& other) const {
+  return exists == other.exists && device == other.device &&
+         inode == other.inode &&
+         modification_time.tv_sec == other.modification_time.tv_sec &&
+         modification_time.tv_nsec == other.modification_time.tv_nsec &&
+         size == other.size;
+}
+
+ConfigWatcher::ConfigWatcher(std::string config_path,
+                             ApplicationArgs command_line_args,
+                             ApplicationManager* manager)
+    : config_path_(std::move(config_path)),
+      image_path_(GetStartupConfigImagePath(config_path_)),
+      command_line_args_(std::move(command_line_args)),
+      manager_(manager),
+      weak_factory_(this) {}
+
+ConfigWatcher::~ConfigWatcher() = default;
+
+void ConfigWatcher::Start() {
+  ftl::RefPtr<ftl::TaskRunner> task_runner =
+      mtl::MessageLoop::GetCurrent()->task_runner();
+  ftl::WeakPtr<ConfigWatcher> weak_this = weak_factory_.GetWeakPtr();
+  std::string config_path = config_path_;
+  std::string image_path = image_path_;
+  manager_->io_pool()->PostTask(
+      [config_path, image_path, task_runner, weak_this] {
+        FileVersion config_version = GetFileVersion(config_path);
+        FileVersion image_version = GetFileVersion(image_path);
+        // The image applied at startup was not checked against the config.
+        bool stale = IsStartupConfigImageStale(config_path);
+        task_runner->PostTask(
+            [weak_this, config_version, image_version, stale] {
+              if (!weak_this)
+                return;
+              weak_this->config_version_ = config_version;
+              weak_this->image_version_ = image_version;
+              if (stale) {
+                FTL_LOG(INFO) << "Startup config image is stale; reloading";
+                weak_this->Reload();
+              }
+              weak_this->ScheduleCheck();
+            });
+      },
+      WorkerPool::Priority::kLow);
+}
+
+void ConfigWatcher::Reload(std::function<void(bool)> callback) {
+  Load(false, std::move(callback));
+}
+
+// static
+ConfigWatcher::FileVersion ConfigWatcher::GetFileVersion(
+    const std::string& path) {
+  FileVersion version;
+  struct stat info;
+  if (stat(path.c_str(), &info) == 0) {
+    version.exists = true;
+    version.device = info.st_dev;
+    version.inode = info.st_ino;
+    version.modification_time = info.st_mtim;
+    version.size = info.st_size;
+  }
+  return version;
+}
+
+void ConfigWatcher::ScheduleCheck() {
+  ftl::WeakPtr<ConfigWatcher> weak_this = weak_factory_.GetWeakPtr();
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this] {
+        if (weak_this)
+          weak_this->Check();
+      },
+      kCheckInterval);
+}
+
+void ConfigWatcher::Check() {
+  // The next check is scheduled once this one is done, so that a slow disk
+  // never has checks piling up.
+  Load(true, [this](bool) { ScheduleCheck(); });
+}
+
+void ConfigWatcher::Load(bool only_if_changed,
+                         std::function<void(bool)> callback) {
+  ftl::RefPtr<ftl::TaskRunner> task_runner =
+      mtl::MessageLoop::GetCurrent()->task_runner();
+  ftl::WeakPtr<ConfigWatcher> weak_this = weak_factory_.GetWeakPtr();
+  std::string config_path = config_path_;
+  std::string image_path = image_path_;
+  FileVersion config_version = config_version_;
+  FileVersion image_version = image_version_;
+  manager_->io_pool()->PostTask(
+      [config_path, image_path, config_version, image_version,
+       only_if_changed, task_runner, weak_this, callback] {
+        // Noted before loading, so that a config that fails to load is not
+        // retried until it changes again.
+        auto loaded = std::make_unique<LoadedConfig>();
+        loaded->config_version = GetFileVersion(config_path);
+        loaded->image_version = GetFileVersion(image_path);
+        if (!only_if_changed || loaded->config_version != config_version ||
+            loaded->image_version != image_version) {
+          loaded->read = true;
+          loaded->succeeded = LoadStartupConfig(
+              config_path, true, &loaded->config, &loaded->image);
+        }
+        task_runner->PostTask(ftl::MakeCopyable([
+          weak_this, callback, loaded = std::move(loaded)
+        ]() mutable {
+          if (weak_this)
+            weak_this->FinishLoad(std::move(loaded), callback);
+        }));
+      },
+      WorkerPool::Priority::kLow);
+}
+
+void ConfigWatcher::FinishLoad(std::unique_ptr<LoadedConfig> loaded,
+                               const std::function<void(bool)>& callback) {
+  if (loaded->read) {
+    config_version_ = loaded->config_version;
+    image_version_ = loaded->image_version;
+    if (loaded->succeeded) {
+      manager_->ApplyStartupConfig(&loaded->config, std::move(loaded->image),
+                                   command_line_args_);
+      FTL_LOG(INFO) << "Reloaded startup config: " << config_path_;
+    } else {
+      FTL_LOG(WARNING) << "Keeping the startup config that was applied before";
+    }
+  }
+  if (callback)
+    callback(loaded->succeeded);
+}
+
+}  // namespace mojo
@@ -0,0 +1,100 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_CONFIG_WATCHER_H_
+#define MOJO_APPLICATION_MANAGER_CONFIG_WATCHER_H_
+
+#include <sys/types.h>
+#include <time.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "mojo/application_manager/application_manager.h"
+#include "mojo/application_manager/startup_config.h"
+
+namespace mojo {
+
+// Reloads the startup config when it (or its compiled image) changes, or when
+// asked to, and applies it to the running application manager (see
+// |ApplicationManager::ApplyStartupConfig|). The files are checked, read and
+// parsed on the manager's I/O pool; only applying the config happens on the
+// message loop. Must be used on the application manager's message loop.
+class ConfigWatcher {
+ public:
+  // |command_line_args| are the arguments given on the command line, which
+  // take precedence over those in the config.
+  ConfigWatcher(std::string config_path,
+                ApplicationArgs command_line_args,
+                ApplicationManager* manager);
+  ~ConfigWatcher();
+
+  // Starts checking the config for changes periodically. The config as it is
+  // now is taken to be the one that has already been applied, except that if
+  // its compiled image turns out to be stale, the config is reloaded.
+  void Start();
+
+  // Reloads the config now. |callback|, if any, is called on the message loop
+  // with whether the config was loaded and applied; if not, the config that
+  // was applied before stays in effect. It is not called if this object has
+  // been destroyed in the meantime.
+  void Reload(std::function<void(bool)> callback = nullptr);
+
+ private:
+  // Enough of a file's metadata to tell that it has changed.
+  struct FileVersion {
+    bool operator==(const FileVersion& other) const;
+    bool operator!=(const FileVersion& other) const {
+      return !(*this == other);
+    }
+
+    bool exists = false;
+    // A file replaced by renaming another over it has a new inode, even if
+    // its time and size are the same.
+    dev_t device = 0;
+    ino_t inode = 0;
+    struct timespec modification_time = {};
+    off_t size = 0;
+  };
+
+  // A config read on the I/O pool, and the versions of the files it was read
+  // from.
+  struct LoadedConfig {
+    FileVersion config_version;
+    FileVersion image_version;
+    // Whether the files were read at all, which they are not if they have
+    // not changed since they were last read.
+    bool read = false;
+    bool succeeded = false;
+    StartupConfig config;
+    std::unique_ptr<StartupConfigImage> image;
+  };
+
+  static FileVersion GetFileVersion(const std::string& path);
+  void ScheduleCheck();
+  void Check();
+  // Reads the config on the I/O pool, unless |only_if_changed| and neither
+  // file has changed, and passes it to |FinishLoad|.
+  void Load(bool only_if_changed, std::function<void(bool)> callback);
+  void FinishLoad(std::unique_ptr<LoadedConfig> loaded,
+                  const std::function<void(bool)>& callback);
+
+  const std::string config_path_;
+  const std::string image_path_;
+  const ApplicationArgs command_line_args_;
+  ApplicationManager* const manager_;
+  FileVersion config_version_;
+  FileVersion image_version_;
+
+  ftl::WeakPtrFactory<ConfigWatcher> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ConfigWatcher);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_CONFIG_WATCHER_H_
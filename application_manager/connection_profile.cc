@@ -0,0 +1,276 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/connection_profile.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "mojo/application_manager/worker_pool.h"
+
+namespace mojo {
+namespace {
+
+constexpr char kLaunches[] = "launches";
+constexpr char kConnectsTo[] = "connects-to";
+
+// Connections made later than this after a launch are not part of starting
+// up, so they are not recorded.
+constexpr ftl::TimeDelta kRecordingWindow = ftl::TimeDelta::FromSeconds(5);
+
+// Recording a launch rewrites the whole file, so writes are batched.
+constexpr ftl::TimeDelta kSaveDelay = ftl::TimeDelta::FromSeconds(10);
+
+// Once an application has this many recorded launches, the counts are halved.
+constexpr uint32_t kMaxRecordedLaunches = 16;
+
+// An application has to have been launched this many times before its
+// connections are trusted to be a habit.
+constexpr uint32_t kMinRecordedLaunches = 2;
+
+// Bounds on the size of the profile.
+constexpr size_t kMaxApplications = 256;
+constexpr size_t kMaxConnectionsPerApplication = 16;
+
+// No more than this many applications are returned by |GetLikelyConnections|.
+constexpr size_t kMaxLikelyConnections = 4;
+
+}  // namespace
+
+ConnectionProfile::ConnectionProfile(std::string path, WorkerPool* io_pool)
+    : path_(std::move(path)), io_pool_(io_pool), weak_factory_(this) {}
+
+ConnectionProfile::~ConnectionProfile() = default;
+
+void ConnectionProfile::Load(std::function<void(bool)> callback) {
+  ftl::RefPtr<ftl::TaskRunner> task_runner =
+      mtl::MessageLoop::GetCurrent()->task_runner();
+  ftl::WeakPtr<ConnectionProfile> weak_this = weak_factory_.GetWeakPtr();
+  std::string path = path_;
+  io_pool_->PostTask(
+      [path, task_runner, weak_this, callback] {
+        EntryMap entries;
+        bool success = ReadEntries(path, &entries);
+        if (!success)
+          entries.clear();
+        task_runner->PostTask(ftl::MakeCopyable([
+          weak_this, callback, success, entries = std::move(entries)
+        ]() mutable {
+          if (!weak_this)
+            return;
+          weak_this->FinishLoad(std::move(entries));
+          callback(success);
+        }));
+      },
+      WorkerPool::Priority::kHigh);
+}
+
+bool ConnectionProfile::ReadEntries(const std::string& path,
+                                    EntryMap* entries) {
+  std::string data;
+  if (!files::ReadFileToString(path, &data))
+    return true;
+
+  rapidjson::Document document;
+  document.Parse(data.data(), data.size());
+  if (document.HasParseError() || !document.IsObject())
+    return false;
+  for (const auto& application : document.GetObject()) {
+    const auto& value = application.value;
+    if (!value.IsObject())
+      return false;
+    auto launches_it = value.FindMember(kLaunches);
+    auto connects_to_it = value.FindMember(kConnectsTo);
+    if (launches_it == value.MemberEnd() || !launches_it->value.IsUint() ||
+        connects_to_it == value.MemberEnd() ||
+        !connects_to_it->value.IsObject())
+      return false;
+    Entry& entry = (*entries)[application.name.GetString()];
+    entry.num_launches = launches_it->value.GetUint();
+    for (const auto& target : connects_to_it->value.GetObject()) {
+      if (!target.value.IsUint())
+        return false;
+      entry.num_connections[target.name.GetString()] = target.value.GetUint();
+    }
+  }
+  return true;
+}
+
+void ConnectionProfile::FinishLoad(EntryMap entries) {
+  FTL_DCHECK(!loaded_);
+  loaded_ = true;
+  // Launches recorded while the file was being read are added to what it held
+  // rather than lost.
+  bool recorded = !entries_.empty();
+  for (auto& application : entries_) {
+    auto it = entries.find(application.first);
+    if (it == entries.end()) {
+      if (entries.size() < kMaxApplications)
+        entries.emplace(application.first, std::move(application.second));
+      continue;
+    }
+    Entry& entry = it->second;
+    entry.num_launches += application.second.num_launches;
+    for (const auto& connection : application.second.num_connections) {
+      auto connection_it = entry.num_connections.find(connection.first);
+      if (connection_it != entry.num_connections.end())
+        connection_it->second += connection.second;
+      else if (entry.num_connections.size() < kMaxConnectionsPerApplication)
+        entry.num_connections.emplace(connection.first, connection.second);
+    }
+  }
+  entries_.swap(entries);
+  if (recorded)
+    ScheduleSave();
+}
+
+void ConnectionProfile::OnLaunched(const std::string& name) {
+  // A relaunch within the window is recorded as part of the first launch.
+  if (!recording_.emplace(name, std::unordered_set<std::string>()).second)
+    return;
+  ftl::WeakPtr<ConnectionProfile> weak_this = weak_factory_.GetWeakPtr();
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this, name] {
+        if (weak_this)
+          weak_this->FinishRecording(name);
+      },
+      kRecordingWindow);
+}
+
+void ConnectionProfile::OnConnection(const std::string& requestor,
+                                     const std::string& target) {
+  auto it = recording_.find(requestor);
+  if (it != recording_.end() && target != requestor)
+    it->second.insert(target);
+}
+
+std::vector<std::string> ConnectionProfile::GetLikelyConnections(
+    const std::string& name) const {
+  std::vector<std::string> result;
+  if (!loaded_)
+    return result;
+  auto it = entries_.find(name);
+  if (it == entries_.end() || it->second.num_launches < kMinRecordedLaunches)
+    return result;
+
+  const Entry& entry = it->second;
+  std::vector<std::pair<uint32_t, const std::string*>> candidates;
+  for (const auto& connection : entry.num_connections) {
+    // Only connections made after at least half of the launches.
+    if (connection.second * 2 >= entry.num_launches)
+      candidates.emplace_back(connection.second, &connection.first);
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<uint32_t, const std::string*>& a,
+               const std::pair<uint32_t, const std::string*>& b) {
+              if (a.first != b.first)
+                return a.first > b.first;
+              return *a.second < *b.second;
+            });
+  for (size_t i = 0; i < candidates.size() && i < kMaxLikelyConnections; ++i)
+    result.push_back(*candidates[i].second);
+  return result;
+}
+
+void ConnectionProfile::FinishRecording(const std::string& name) {
+  auto it = recording_.find(name);
+  if (it == recording_.end())
+    return;
+  std::unordered_set<std::string> targets = std::move(it->second);
+  recording_.erase(it);
+
+  auto entry_it = entries_.find(name);
+  if (entry_it == entries_.end()) {
+    // Applications that connect to nothing are not worth a place.
+    if (targets.empty() || entries_.size() >= kMaxApplications)
+      return;
+    entry_it = entries_.emplace(name, Entry()).first;
+  }
+  Entry& entry = entry_it->second;
+  ++entry.num_launches;
+  for (const auto& target : targets) {
+    auto connection_it = entry.num_connections.find(target);
+    if (connection_it != entry.num_connections.end())
+      ++connection_it->second;
+    else if (entry.num_connections.size() < kMaxConnectionsPerApplication)
+      entry.num_connections.emplace(target, 1u);
+  }
+
+  if (entry.num_launches >= kMaxRecordedLaunches) {
+    entry.num_launches /= 2;
+    for (auto connection_it = entry.num_connections.begin();
+         connection_it != entry.num_connections.end();) {
+      connection_it->second /= 2;
+      if (connection_it->second == 0)
+        connection_it = entry.num_connections.erase(connection_it);
+      else
+        ++connection_it;
+    }
+  }
+  ScheduleSave();
+}
+
+void ConnectionProfile::ScheduleSave() {
+  // Saving before the file has been read would overwrite it with what little
+  // has been recorded since. |FinishLoad| saves once it has been read.
+  if (save_scheduled_ || !loaded_)
+    return;
+  save_scheduled_ = true;
+  ftl::WeakPtr<ConnectionProfile> weak_this = weak_factory_.GetWeakPtr();
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this] {
+        if (!weak_this)
+          return;
+        weak_this->save_scheduled_ = false;
+        std::string path = weak_this->path_;
+        std::string data = weak_this->ToJson();
+        weak_this->io_pool_->PostTask(
+            [path, data] {
+              // Written aside and renamed, so a crash never leaves half a
+              // profile behind.
+              std::string temp_path = path + ".tmp";
+              if (!files::WriteFile(temp_path, data.data(), data.size()) ||
+                  rename(temp_path.c_str(), path.c_str()) != 0) {
+                FTL_LOG(WARNING) << "Failed to save connection profile: "
+                                 << path;
+              }
+            },
+            WorkerPool::Priority::kLow);
+      },
+      kSaveDelay);
+}
+
+std::string ConnectionProfile::ToJson() const {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  for (const auto& application : entries_) {
+    writer.Key(application.first.c_str());
+    writer.StartObject();
+    writer.Key(kLaunches);
+    writer.Uint(application.second.num_launches);
+    writer.Key(kConnectsTo);
+    writer.StartObject();
+    for (const auto& connection : application.second.num_connections) {
+      writer.Key(connection.first.c_str());
+      writer.Uint(connection.second);
+    }
+    writer.EndObject();
+    writer.EndObject();
+  }
+  writer.EndObject();
+  return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+}  // namespace mojo
@@ -0,0 +1,88 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_CONNECTION_PROFILE_H_
+#define MOJO_APPLICATION_MANAGER_CONNECTION_PROFILE_H_
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+
+namespace mojo {
+class WorkerPool;
+
+// Records which applications each application connects to in the first
+// seconds after it is launched, so that later launches can start those
+// applications at the same time rather than one after another as the
+// connections come in.
+//
+// The profile is loaded from and saved to a file, so that what was learned
+// carries over to the next boot. Must be used on a single message loop.
+class ConnectionProfile {
+ public:
+  // The profile is saved to |path| on |io_pool|.
+  ConnectionProfile(std::string path, WorkerPool* io_pool);
+  ~ConnectionProfile();
+
+  // Reads the profile saved by an earlier run, if any, on the I/O pool, so
+  // that the message loop does not wait on the disk. Until it has been read,
+  // no connections are predicted and nothing is saved.
+  //
+  // |callback| is called on the current message loop once the file has been
+  // read, with false if it exists but could not be parsed, in which case the
+  // profile starts out empty. It is not called if this object has been
+  // destroyed in the meantime.
+  void Load(std::function<void(bool)> callback);
+
+  // Starts recording the connections made by |name|, which has just been
+  // launched.
+  void OnLaunched(const std::string& name);
+
+  // Notes that |requestor| connected to |target|.
+  void OnConnection(const std::string& requestor, const std::string& target);
+
+  // Returns the applications that |name| has connected to soon after most of
+  // its recent launches, most often first.
+  std::vector<std::string> GetLikelyConnections(const std::string& name) const;
+
+ private:
+  friend class ConnectionProfileTest;
+
+  struct Entry {
+    // The number of recorded launches, and how many of them connected to each
+    // application. Halved once there are enough, so that old habits fade.
+    uint32_t num_launches = 0;
+    std::unordered_map<std::string, uint32_t> num_connections;
+  };
+  using EntryMap = std::unordered_map<std::string, Entry>;
+
+  // Parses the profile in |path| into |entries|. Returns true, leaving
+  // |entries| empty, if there is no such file.
+  static bool ReadEntries(const std::string& path, EntryMap* entries);
+  void FinishLoad(EntryMap entries);
+  void FinishRecording(const std::string& name);
+  void ScheduleSave();
+  std::string ToJson() const;
+
+  const std::string path_;
+  WorkerPool* const io_pool_;
+  EntryMap entries_;
+  bool loaded_ = false;
+  // The applications launched recently, and what they have connected to since.
+  std::unordered_map<std::string, std::unordered_set<std::string>> recording_;
+  bool save_scheduled_ = false;
+
+  ftl::WeakPtrFactory<ConnectionProfile> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ConnectionProfile);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_CONNECTION_PROFILE_H_
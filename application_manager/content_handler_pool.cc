@@ -0,0 +1,150 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/content_handler_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "lib/ftl/logging.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace mojo {
+namespace {
+
+// How long a replica other than 0 may run nothing before it is stopped. Long
+// enough that a burst of launches does not start and stop replicas over and
+// over.
+constexpr ftl::TimeDelta kIdleReplicaTimeout = ftl::TimeDelta::FromSeconds(30);
+
+}  // namespace
+
+ContentHandlerPool::Lease::Lease(ftl::WeakPtr<ContentHandlerPool> pool,
+                                 size_t replica)
+    : pool_(std::move(pool)), replica_(replica) {}
+
+ContentHandlerPool::Lease::~Lease() {
+  if (pool_)
+    pool_->Release(replica_);
+}
+
+ContentHandlerPool::ContentHandlerPool(
+    Options options,
+    std::function<void(size_t replica)> stop_replica)
+    : options_(options),
+      stop_replica_(std::move(stop_replica)),
+      replicas_(num_replicas()),
+      weak_factory_(this) {}
+
+ContentHandlerPool::~ContentHandlerPool() = default;
+
+std::unique_ptr<ContentHandlerPool::Lease> ContentHandlerPool::Dispatch(
+    const std::string& url) {
+  size_t replica = options_.policy == Policy::kConsistentHash
+                       ? ChooseByHash(url)
+                       : ChooseLeastLoaded();
+  replicas_[replica].active = true;
+  ++replicas_[replica].load;
+  return std::unique_ptr<Lease>(
+      new Lease(weak_factory_.GetWeakPtr(), replica));
+}
+
+void ContentHandlerPool::SetOptions(Options options) {
+  options_ = options;
+  for (size_t i = num_replicas(); i < replicas_.size(); ++i) {
+    if (replicas_[i].active && replicas_[i].load == 0) {
+      replicas_[i].active = false;
+      stop_replica_(i);
+    }
+  }
+  // Replicas still running applications are stopped by |Release|.
+  while (replicas_.size() > num_replicas() && !replicas_.back().active)
+    replicas_.pop_back();
+  if (replicas_.size() < num_replicas())
+    replicas_.resize(num_replicas());
+}
+
+size_t ContentHandlerPool::num_active_replicas() const {
+  size_t count = 0;
+  for (const auto& replica : replicas_) {
+    if (replica.active)
+      ++count;
+  }
+  return count;
+}
+
+// static
+size_t ContentHandlerPool::JumpConsistentHash(uint64_t key,
+                                              size_t num_buckets) {
+  int64_t bucket = -1;
+  int64_t next = 0;
+  while (next < static_cast<int64_t>(num_buckets)) {
+    bucket = next;
+    key = key * 2862933555777941757ULL + 1;
+    next = static_cast<int64_t>((bucket + 1) *
+                                (static_cast<double>(1LL << 31) /
+                                 static_cast<double>((key >> 33) + 1)));
+  }
+  return static_cast<size_t>(bucket);
+}
+
+size_t ContentHandlerPool::ChooseLeastLoaded() {
+  size_t count = num_replicas();
+  size_t best = count;
+  size_t first_inactive = count;
+  for (size_t i = 0; i < count; ++i) {
+    if (!replicas_[i].active) {
+      if (first_inactive == count)
+        first_inactive = i;
+      continue;
+    }
+    if (best == count || replicas_[i].load < replicas_[best].load)
+      best = i;
+  }
+  // Start another replica only once even the least loaded one is full.
+  if (first_inactive != count &&
+      (best == count || replicas_[best].load >= options_.max_load))
+    return first_inactive;
+  return best;
+}
+
+size_t ContentHandlerPool::ChooseByHash(const std::string& url) const {
+  return JumpConsistentHash(std::hash<std::string>()(url), num_replicas());
+}
+
+void ContentHandlerPool::Release(size_t replica) {
+  FTL_DCHECK(replicas_[replica].load > 0);
+  if (--replicas_[replica].load > 0 || replica == 0)
+    return;
+  if (replica >= num_replicas()) {
+    // Left over from earlier options, so it will not be needed again.
+    replicas_[replica].active = false;
+    stop_replica_(replica);
+    return;
+  }
+  replicas_[replica].idle_since = ftl::TimePoint::Now();
+  ftl::WeakPtr<ContentHandlerPool> weak_this = weak_factory_.GetWeakPtr();
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this, replica] {
+        if (weak_this)
+          weak_this->MaybeStopReplica(replica);
+      },
+      kIdleReplicaTimeout);
+}
+
+void ContentHandlerPool::MaybeStopReplica(size_t replica) {
+  // The replica may have been busy again since the check was scheduled, or
+  // dropped by |SetOptions|.
+  if (replica >= replicas_.size())
+    return;
+  const Replica& state = replicas_[replica];
+  if (!state.active || state.load > 0 ||
+      ftl::TimePoint::Now() - state.idle_since < kIdleReplicaTimeout)
+    return;
+  replicas_[replica].active = false;
+  stop_replica_(replica);
+}
+
+}  // namespace mojo
@@ -0,0 +1,129 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_CONTENT_HANDLER_POOL_H_
+#define MOJO_APPLICATION_MANAGER_CONTENT_HANDLER_POOL_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_point.h"
+
+namespace mojo {
+
+// Spreads the applications run by one content handler over several instances
+// (replicas) of it, so that a single handler process is not a bottleneck when
+// many applications with its content start together.
+//
+// Replica 0 is the ordinary instance of the content handler. More replicas are
+// started when every running replica is running at least |max_load|
+// applications, up to |max_instances|, and a replica other than 0 is stopped
+// once it has run nothing for a while.
+//
+// The pool only does the bookkeeping; starting and stopping the replicas is up
+// to the caller. Must be used on a single message loop.
+class ContentHandlerPool {
+ public:
+  enum class Policy {
+    // Each application goes to the replica running the fewest applications.
+    kLeastLoaded,
+    // Each application goes to a replica chosen by hashing its URL, so that
+    // the same content always goes to the same replica (and finds its caches
+    // warm), as long as |max_instances| does not change.
+    kConsistentHash,
+  };
+
+  struct Options {
+    bool operator==(const Options& other) const {
+      return max_instances == other.max_instances && policy == other.policy &&
+             max_load == other.max_load;
+    }
+    bool operator!=(const Options& other) const { return !(*this == other); }
+
+    size_t max_instances = 1;
+    Policy policy = Policy::kLeastLoaded;
+    // With |kLeastLoaded|, how many applications a replica may run before
+    // another replica is started, rather than give it one more. Starting a
+    // replica costs more than a handler running a few applications at once.
+    size_t max_load = 4;
+  };
+
+  // Counts an application against the load of the replica running it, until
+  // destroyed.
+  class Lease {
+   public:
+    ~Lease();
+
+    size_t replica() const { return replica_; }
+
+   private:
+    friend class ContentHandlerPool;
+
+    Lease(ftl::WeakPtr<ContentHandlerPool> pool, size_t replica);
+
+    ftl::WeakPtr<ContentHandlerPool> pool_;
+    const size_t replica_;
+
+    FTL_DISALLOW_COPY_AND_ASSIGN(Lease);
+  };
+
+  // |stop_replica| is called with the index of a replica that should be
+  // stopped because it has been idle.
+  ContentHandlerPool(Options options,
+                     std::function<void(size_t replica)> stop_replica);
+  ~ContentHandlerPool();
+
+  // Chooses the replica that should run the application at |url|.
+  std::unique_ptr<Lease> Dispatch(const std::string& url);
+
+  // Changes the options from the next |Dispatch|. Replicas beyond the new
+  // |max_instances| are given no more applications, and are stopped as soon
+  // as they are running none.
+  void SetOptions(Options options);
+
+  size_t num_active_replicas() const;
+
+  // Maps |key| to one of |num_buckets| buckets such that changing the number
+  // of buckets moves as few keys as possible (Lamping and Veach, "A Fast,
+  // Minimal Memory, Consistent Hash Algorithm"). Growing from n buckets to
+  // n + 1 only moves keys to bucket n.
+  static size_t JumpConsistentHash(uint64_t key, size_t num_buckets);
+
+ private:
+  struct Replica {
+    bool active = false;
+    size_t load = 0;
+    ftl::TimePoint idle_since;
+  };
+
+  // The number of replicas that applications may be dispatched to.
+  size_t num_replicas() const {
+    return std::max<size_t>(options_.max_instances, 1);
+  }
+  size_t ChooseLeastLoaded();
+  size_t ChooseByHash(const std::string& url) const;
+  void Release(size_t replica);
+  void MaybeStopReplica(size_t replica);
+
+  Options options_;
+  std::function<void(size_t replica)> stop_replica_;
+  // At least |num_replicas()| long, and longer while replicas beyond that,
+  // left from earlier options, are still running applications.
+  std::vector<Replica> replicas_;
+
+  ftl::WeakPtrFactory<ContentHandlerPool> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ContentHandlerPool);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_CONTENT_HANDLER_POOL_H_
@@ -0,0 +1,297 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures how long the application manager takes to launch an application,
+// from the connection that starts it until the application is done with the
+// connection. Runs an application manager in process and connects to each
+// application many times, first one launch at a time and then several at a
+// time. By default, the applications are those in //mojo/examples/tiny:
+//
+//   mojo:tiny         Closes its application request as soon as it starts, so
+//                     a launch ends when the manager notices that it is gone.
+//   mojo:tiny_accept  Completes Initialize and one AcceptConnection, then
+//                     quits.
+//
+// Usage: mojo_launch_benchmark [--iterations=<n>] [--concurrency=<n>]
+//                              [<mojo: name>...]
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "mojo/application_manager/application_manager.h"
+
+namespace mojo {
+namespace {
+
+constexpr size_t kDefaultIterations = 100;
+constexpr size_t kDefaultConcurrency = 8;
+
+const char* const kDefaultApplications[] = {
+    "mojo:tiny",
+    "mojo:tiny_accept",
+};
+
+// Returns the |percentile|th percentile of |sorted|, by nearest rank.
+ftl::TimeDelta GetPercentile(const std::vector<ftl::TimeDelta>& sorted,
+                             size_t percentile) {
+  if (sorted.empty())
+    return ftl::TimeDelta::Zero();
+  size_t rank = (percentile * sorted.size() + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+double ToMilliseconds(ftl::TimeDelta delta) {
+  return delta.ToMicroseconds() / 1000.0;
+}
+
+// Launches one application a number of times, a number of launches at a
+// time, and records how long each launch took.
+class LaunchRun {
+ public:
+  LaunchRun(ApplicationManager* manager,
+            const std::string& application,
+            size_t iterations,
+            size_t concurrency);
+  ~LaunchRun();
+
+  // Starts the launches. |callback| is called once they have all finished, or
+  // once one has failed.
+  void Start(ftl::Closure callback);
+
+  // Prints the latency percentiles and the throughput. Returns false if a
+  // launch failed.
+  bool Report() const;
+
+ private:
+  // Each slot launches its own instance of the application, one launch after
+  // another.
+  struct Slot {
+    std::string name;
+    ApplicationId id = kInvalidApplicationId;
+    ServiceProviderPtr services;
+    uint32_t num_launch_failures = 0;
+    ftl::TimePoint start_time;
+    ftl::TimePoint end_time;
+    // Whether the connection has closed but the manager has yet to let go of
+    // the instance.
+    bool waiting_for_stop = false;
+  };
+
+  void Launch(Slot* slot);
+  void OnConnectionClosed(Slot* slot);
+  void OnApplicationStopped(ApplicationId id);
+  void FinishLaunch(Slot* slot);
+  uint32_t GetLaunchFailures(ApplicationId id) const;
+
+  ApplicationManager* const manager_;
+  const std::string application_;
+  const size_t iterations_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+  size_t num_started_ = 0;
+  size_t num_idle_slots_ = 0;
+  bool failed_ = false;
+  std::vector<ftl::TimeDelta> latencies_;
+  ftl::TimePoint start_time_;
+  ftl::TimePoint end_time_;
+  ftl::Closure callback_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LaunchRun);
+};
+
+LaunchRun::LaunchRun(ApplicationManager* manager,
+                     const std::string& application,
+                     size_t iterations,
+                     size_t concurrency)
+    : manager_(manager), application_(application), iterations_(iterations) {
+  FTL_DCHECK(iterations_ > 0);
+  FTL_DCHECK(concurrency > 0);
+  for (size_t i = 0; i < std::min(concurrency, iterations_); ++i) {
+    auto slot = std::make_unique<Slot>();
+    // The benchmark lists |application_| as an instance-per-query
+    // application, so each slot gets an instance of its own.
+    slot->name = application_ + "?benchmark-slot=" + std::to_string(i);
+    slots_.push_back(std::move(slot));
+  }
+  latencies_.reserve(iterations_);
+}
+
+LaunchRun::~LaunchRun() {}
+
+void LaunchRun::Start(ftl::Closure callback) {
+  callback_ = std::move(callback);
+  manager_->set_application_stopped_callback(
+      [this](ApplicationId id) { OnApplicationStopped(id); });
+  start_time_ = ftl::TimePoint::Now();
+  for (const auto& slot : slots_)
+    Launch(slot.get());
+}
+
+void LaunchRun::Launch(Slot* slot) {
+  ++num_started_;
+  // The manager releases the names of stopped instances in time, so the id
+  // is looked up afresh for each launch.
+  slot->id = manager_->names()->Intern(slot->name);
+  slot->num_launch_failures = GetLaunchFailures(slot->id);
+  slot->start_time = ftl::TimePoint::Now();
+  manager_->ConnectToApplication(slot->name, manager_->self_id(),
+                                 GetProxy(&slot->services));
+  // The application closes the connection once it is done with it. If the
+  // launch fails, the manager closes it instead.
+  slot->services.set_connection_error_handler(
+      [this, slot] { OnConnectionClosed(slot); });
+}
+
+void LaunchRun::OnConnectionClosed(Slot* slot) {
+  slot->end_time = ftl::TimePoint::Now();
+  // The next launch must not reach the instance that is about to go away, so
+  // it waits for the manager to report that the instance has stopped.
+  if (manager_->IsRunning(slot->id)) {
+    slot->waiting_for_stop = true;
+    return;
+  }
+  // |slot->services| is still running this handler, so it is reset later.
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostTask(
+      [this, slot] { FinishLaunch(slot); });
+}
+
+void LaunchRun::OnApplicationStopped(ApplicationId id) {
+  for (const auto& slot : slots_) {
+    if (slot->id != id || !slot->waiting_for_stop)
+      continue;
+    slot->waiting_for_stop = false;
+    // The manager is still stopping the instance, so the next launch is
+    // started later.
+    Slot* waiting_slot = slot.get();
+    mtl::MessageLoop::GetCurrent()->task_runner()->PostTask(
+        [this, waiting_slot] { FinishLaunch(waiting_slot); });
+    return;
+  }
+}
+
+void LaunchRun::FinishLaunch(Slot* slot) {
+  slot->services.reset();
+  if (GetLaunchFailures(slot->id) != slot->num_launch_failures)
+    failed_ = true;
+  else
+    latencies_.push_back(slot->end_time - slot->start_time);
+
+  if (!failed_ && num_started_ < iterations_) {
+    Launch(slot);
+    return;
+  }
+  if (++num_idle_slots_ == slots_.size()) {
+    end_time_ = ftl::TimePoint::Now();
+    manager_->set_application_stopped_callback(nullptr);
+    callback_();
+  }
+}
+
+uint32_t LaunchRun::GetLaunchFailures(ApplicationId id) const {
+  auto it = manager_->counters().find(id);
+  return it != manager_->counters().end() ? it->second.num_launch_failures
+                                          : 0u;
+}
+
+bool LaunchRun::Report() const {
+  if (failed_) {
+    fprintf(stderr, "launch_benchmark: Failed to launch %s\n",
+            application_.c_str());
+    return false;
+  }
+  std::vector<ftl::TimeDelta> sorted = latencies_;
+  std::sort(sorted.begin(), sorted.end());
+  double seconds = ToMilliseconds(end_time_ - start_time_) / 1000.0;
+  printf("%s, %zu at a time: %zu launches in %.3f s (%.1f launches/s)\n",
+         application_.c_str(), slots_.size(), sorted.size(), seconds,
+         seconds > 0 ? sorted.size() / seconds : 0.0);
+  printf("  p50 %8.3f ms  p95 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n",
+         ToMilliseconds(GetPercentile(sorted, 50)),
+         ToMilliseconds(GetPercentile(sorted, 95)),
+         ToMilliseconds(GetPercentile(sorted, 99)),
+         ToMilliseconds(sorted.back()));
+  return true;
+}
+
+bool GetCountOption(const ftl::CommandLine& command_line,
+                    const std::string& name,
+                    size_t* value) {
+  std::string string;
+  if (!command_line.GetOptionValue(name, &string))
+    return true;
+  return ftl::StringToNumberWithError(string, value) && *value > 0;
+}
+
+}  // namespace
+}  // namespace mojo
+
+int main(int argc, char** argv) {
+  auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+
+  size_t iterations = mojo::kDefaultIterations;
+  size_t concurrency = mojo::kDefaultConcurrency;
+  const std::vector<std::string>& names = command_line.positional_args();
+  if (!mojo::GetCountOption(command_line, "iterations", &iterations) ||
+      !mojo::GetCountOption(command_line, "concurrency", &concurrency) ||
+      !std::all_of(names.begin(), names.end(),
+                   mojo::ApplicationNames::IsLaunchable)) {
+    fprintf(stderr,
+            "Usage: mojo_launch_benchmark [--iterations=<n>] "
+            "[--concurrency=<n>] [<mojo: name>...]\n");
+    return 1;
+  }
+
+  std::vector<std::string> applications = names;
+  if (applications.empty()) {
+    applications.assign(std::begin(mojo::kDefaultApplications),
+                        std::end(mojo::kDefaultApplications));
+  }
+
+  mtl::MessageLoop message_loop;
+  mojo::ApplicationManager manager(
+      mojo::ApplicationArgs(),
+      std::unordered_set<std::string>(applications.begin(),
+                                      applications.end()));
+
+  std::vector<std::unique_ptr<mojo::LaunchRun>> runs;
+  for (const auto& application : applications) {
+    runs.push_back(std::make_unique<mojo::LaunchRun>(&manager, application,
+                                                     iterations, 1));
+    if (concurrency > 1) {
+      runs.push_back(std::make_unique<mojo::LaunchRun>(
+          &manager, application, iterations, concurrency));
+    }
+  }
+
+  // The runs take turns, so that they do not compete with each other.
+  size_t next_run = 0;
+  std::function<void()> start_next_run;
+  start_next_run = [&runs, &next_run, &start_next_run, &message_loop] {
+    if (next_run == runs.size()) {
+      message_loop.PostQuitTask();
+      return;
+    }
+    runs[next_run++]->Start(start_next_run);
+  };
+  message_loop.task_runner()->PostTask(start_next_run);
+  message_loop.Run();
+
+  bool succeeded = true;
+  for (const auto& run : runs)
+    succeeded = run->Report() && succeeded;
+  return succeeded ? 0 : 1;
+}
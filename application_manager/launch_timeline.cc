@@ -0,0 +1,40 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/launch_timeline.h"
+
+namespace mojo {
+
+const char* LaunchTimeline::GetStageName(Stage stage) {
+  switch (stage) {
+    case Stage::kStarted:
+      return "started";
+    case Stage::kNameResolved:
+      return "name_resolved";
+    case Stage::kFileOpened:
+      return "file_opened";
+    case Stage::kFileClassified:
+      return "file_classified";
+    case Stage::kLaunchpadCreated:
+      return "launchpad_created";
+    case Stage::kProcessStarted:
+      return "process_started";
+    case Stage::kInitializeSent:
+      return "initialize_sent";
+    case Stage::kReady:
+      return "ready";
+    case Stage::kFirstConnection:
+      return "first_connection";
+  }
+  return "unknown";
+}
+
+void LaunchTimeline::Merge(const LaunchTimeline& other) {
+  for (size_t i = 0; i < kNumStages; ++i) {
+    if (other.times_[i] != ftl::TimePoint())
+      times_[i] = other.times_[i];
+  }
+}
+
+}  // namespace mojo
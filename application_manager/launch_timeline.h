@@ -0,0 +1,57 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_LAUNCH_TIMELINE_H_
+#define MOJO_APPLICATION_MANAGER_LAUNCH_TIMELINE_H_
+
+#include <stddef.h>
+
+#include "lib/ftl/time/time_point.h"
+
+namespace mojo {
+
+// When each stage of starting one application was reached, on the monotonic
+// clock. Stages that were skipped (e.g., creating a process for content that
+// is run by a content handler) are left unset.
+class LaunchTimeline {
+ public:
+  enum class Stage {
+    kStarted,
+    kNameResolved,
+    kFileOpened,
+    kFileClassified,
+    kLaunchpadCreated,
+    kProcessStarted,
+    kInitializeSent,
+    kReady,
+    kFirstConnection,
+  };
+  static constexpr size_t kNumStages =
+      static_cast<size_t>(Stage::kFirstConnection) + 1;
+
+  // Returns a short name for |stage|, for traces and summaries.
+  static const char* GetStageName(Stage stage);
+
+  // Copies the stages that |other| has reached into this timeline.
+  void Merge(const LaunchTimeline& other);
+
+  void Mark(Stage stage) { Mark(stage, ftl::TimePoint::Now()); }
+  void Mark(Stage stage, ftl::TimePoint time) {
+    times_[static_cast<size_t>(stage)] = time;
+  }
+
+  bool has(Stage stage) const {
+    return times_[static_cast<size_t>(stage)] != ftl::TimePoint();
+  }
+  ftl::TimePoint time(Stage stage) const {
+    return times_[static_cast<size_t>(stage)];
+  }
+
+ private:
+  ftl::TimePoint times_[kNumStages];
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_LAUNCH_TIMELINE_H_
@@ -0,0 +1,200 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/launch_tracer.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "lib/ftl/strings/split_string.h"
+#include "lib/ftl/strings/string_printf.h"
+#include "mojo/services/tracing/interfaces/trace_provider_registry.mojom.h"
+
+namespace mojo {
+namespace {
+
+constexpr char kTraceCategory[] = "application_manager";
+
+// The number of recent launches of each application kept for the summary.
+constexpr size_t kMaxHistory = 100;
+
+const LaunchTimeline::Stage kStages[] = {
+    LaunchTimeline::Stage::kStarted,
+    LaunchTimeline::Stage::kNameResolved,
+    LaunchTimeline::Stage::kFileOpened,
+    LaunchTimeline::Stage::kFileClassified,
+    LaunchTimeline::Stage::kLaunchpadCreated,
+    LaunchTimeline::Stage::kProcessStarted,
+    LaunchTimeline::Stage::kInitializeSent,
+    LaunchTimeline::Stage::kReady,
+    LaunchTimeline::Stage::kFirstConnection,
+};
+static_assert(sizeof(kStages) / sizeof(kStages[0]) ==
+                  LaunchTimeline::kNumStages,
+              "Every stage must be listed");
+
+std::string EscapeJsonString(const std::string& string) {
+  std::string escaped;
+  escaped.reserve(string.size());
+  for (char c : string) {
+    // Compared and printed unsigned, since |char| may be signed.
+    unsigned char byte = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      escaped.push_back('\\');
+      escaped.push_back(c);
+    } else if (byte < 0x20) {
+      escaped += ftl::StringPrintf("\\u%04x", static_cast<unsigned>(byte));
+    } else {
+      escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+int64_t ToMicroseconds(ftl::TimePoint time) {
+  return (time - ftl::TimePoint()).ToMicroseconds();
+}
+
+// Returns the |percentile|th percentile of |durations| (nearest rank).
+ftl::TimeDelta GetPercentile(std::vector<ftl::TimeDelta> durations,
+                             size_t percentile) {
+  if (durations.empty())
+    return ftl::TimeDelta::Zero();
+  size_t rank = (percentile * durations.size() + 99) / 100;
+  size_t index = rank > 0 ? rank - 1 : 0;
+  std::nth_element(durations.begin(), durations.begin() + index,
+                   durations.end());
+  return durations[index];
+}
+
+}  // namespace
+
+LaunchTracer::LaunchTracer() : binding_(this) {}
+
+LaunchTracer::~LaunchTracer() = default;
+
+void LaunchTracer::RegisterWithTracing(ServiceProviderPtr tracing_services) {
+  tracing::TraceProviderRegistryPtr registry;
+  tracing_services->ConnectToService(
+      tracing::TraceProviderRegistry::Name_,
+      GetProxy(&registry).PassMessagePipe());
+  InterfaceHandle<tracing::TraceProvider> provider;
+  binding_.Bind(GetProxy(&provider));
+  registry->RegisterTraceProvider(std::move(provider));
+}
+
+void LaunchTracer::RecordLaunch(const std::string& name,
+                                const LaunchTimeline& timeline) {
+  if (!timeline.has(LaunchTimeline::Stage::kStarted))
+    return;
+  ftl::TimePoint start = timeline.time(LaunchTimeline::Stage::kStarted);
+  History& history = histories_[name];
+  ++history.num_launches;
+  for (LaunchTimeline::Stage stage : kStages) {
+    if (stage == LaunchTimeline::Stage::kStarted || !timeline.has(stage))
+      continue;
+    StageDurations& durations = history.durations[static_cast<size_t>(stage)];
+    durations.push_back(timeline.time(stage) - start);
+    if (durations.size() > kMaxHistory)
+      durations.pop_front();
+  }
+  if (recorder_)
+    TraceLaunch(name, timeline);
+}
+
+std::string LaunchTracer::GetSummary() const {
+  // Sorted, so that the summary is easy to scan.
+  std::map<std::string, const History*> sorted;
+  for (const auto& entry : histories_)
+    sorted.emplace(entry.first, &entry.second);
+
+  std::string summary;
+  for (const auto& entry : sorted) {
+    const History& history = *entry.second;
+    summary += ftl::StringPrintf("%s: %zu launches\n", entry.first.c_str(),
+                                 history.num_launches);
+    for (LaunchTimeline::Stage stage : kStages) {
+      const StageDurations& durations =
+          history.durations[static_cast<size_t>(stage)];
+      if (durations.empty())
+        continue;
+      std::vector<ftl::TimeDelta> samples(durations.begin(), durations.end());
+      summary += ftl::StringPrintf(
+          "  %-18s p50 %8.3f ms  p99 %8.3f ms  (%zu samples)\n",
+          LaunchTimeline::GetStageName(stage),
+          GetPercentile(samples, 50).ToMicroseconds() / 1000.0,
+          GetPercentile(samples, 99).ToMicroseconds() / 1000.0,
+          samples.size());
+    }
+  }
+  return summary;
+}
+
+bool LaunchTracer::GetPercentiles(const std::string& name,
+                                  LaunchTimeline::Stage stage,
+                                  ftl::TimeDelta* p50,
+                                  ftl::TimeDelta* p99) const {
+  auto it = histories_.find(name);
+  if (it == histories_.end())
+    return false;
+  const StageDurations& durations =
+      it->second.durations[static_cast<size_t>(stage)];
+  if (durations.empty())
+    return false;
+  std::vector<ftl::TimeDelta> samples(durations.begin(), durations.end());
+  *p50 = GetPercentile(samples, 50);
+  *p99 = GetPercentile(samples, 99);
+  return true;
+}
+
+void LaunchTracer::StartTracing(
+    const String& categories,
+    InterfaceHandle<tracing::TraceRecorder> recorder) {
+  std::vector<std::string> requested = ftl::SplitStringCopy(
+      categories.get(), ",", ftl::kTrimWhitespace, ftl::kSplitWantNonEmpty);
+  if (!requested.empty() &&
+      std::find(requested.begin(), requested.end(), kTraceCategory) ==
+          requested.end())
+    return;
+  recorder_ = tracing::TraceRecorderPtr::Create(std::move(recorder));
+}
+
+void LaunchTracer::StopTracing() {
+  recorder_.reset();
+}
+
+void LaunchTracer::TraceLaunch(const std::string& name,
+                               const LaunchTimeline& timeline) {
+  // Each stage is traced as a complete event spanning from the stage reached
+  // before it, so the events tile the whole launch. Stages are not always
+  // reached in the order they are declared (the first connection may be sent
+  // before the application is ready), so they are taken in time order.
+  std::vector<LaunchTimeline::Stage> reached;
+  for (LaunchTimeline::Stage stage : kStages) {
+    if (stage != LaunchTimeline::Stage::kStarted && timeline.has(stage))
+      reached.push_back(stage);
+  }
+  std::stable_sort(reached.begin(), reached.end(),
+                   [&timeline](LaunchTimeline::Stage a,
+                               LaunchTimeline::Stage b) {
+                     return timeline.time(a) < timeline.time(b);
+                   });
+  std::string escaped_name = EscapeJsonString(name);
+  ftl::TimePoint previous = timeline.time(LaunchTimeline::Stage::kStarted);
+  for (LaunchTimeline::Stage stage : reached) {
+    ftl::TimePoint time = timeline.time(stage);
+    recorder_->Record(ftl::StringPrintf(
+        "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,"
+        "\"ts\":%lld,\"dur\":%lld,\"args\":{\"app\":\"%s\"}}",
+        LaunchTimeline::GetStageName(stage), kTraceCategory,
+        static_cast<long long>(ToMicroseconds(previous)),
+        static_cast<long long>((time - previous).ToMicroseconds()),
+        escaped_name.c_str()));
+    previous = time;
+  }
+}
+
+}  // namespace mojo
@@ -0,0 +1,74 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_LAUNCH_TRACER_H_
+#define MOJO_APPLICATION_MANAGER_LAUNCH_TRACER_H_
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_delta.h"
+#include "mojo/application_manager/launch_timeline.h"
+#include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/interfaces/application/service_provider.mojom.h"
+#include "mojo/services/tracing/interfaces/tracing.mojom.h"
+
+namespace mojo {
+
+// Collects the timelines of application launches. While tracing, each
+// timeline is sent as trace events to the tracing service, as a
+// tracing.TraceProvider. The recent launches of each application are also
+// kept for a summary of how long they took.
+class LaunchTracer : public tracing::TraceProvider {
+ public:
+  LaunchTracer();
+  ~LaunchTracer() override;
+
+  // Registers as a trace provider with the tracing.TraceProviderRegistry
+  // offered by |tracing_services|.
+  void RegisterWithTracing(ServiceProviderPtr tracing_services);
+
+  // Records the timeline of a launch of |name| that has finished.
+  void RecordLaunch(const std::string& name, const LaunchTimeline& timeline);
+
+  // Returns a human-readable summary of the recent launches of each
+  // application: how many there were, and the median and 99th percentile of
+  // the time taken to reach each stage.
+  std::string GetSummary() const;
+
+  // Sets |*p50| and |*p99| to the median and 99th percentile of the time
+  // recent launches of |name| took to reach |stage|. Returns false if there
+  // have been none.
+  bool GetPercentiles(const std::string& name,
+                      LaunchTimeline::Stage stage,
+                      ftl::TimeDelta* p50,
+                      ftl::TimeDelta* p99) const;
+
+  // |tracing::TraceProvider|:
+  void StartTracing(
+      const String& categories,
+      InterfaceHandle<tracing::TraceRecorder> recorder) override;
+  void StopTracing() override;
+
+ private:
+  using StageDurations = std::deque<ftl::TimeDelta>;
+  struct History {
+    size_t num_launches = 0;
+    StageDurations durations[LaunchTimeline::kNumStages];
+  };
+
+  void TraceLaunch(const std::string& name, const LaunchTimeline& timeline);
+
+  Binding<tracing::TraceProvider> binding_;
+  tracing::TraceRecorderPtr recorder_;
+  std::unordered_map<std::string, History> histories_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LaunchTracer);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_LAUNCH_TRACER_H_
@@ -0,0 +1,100 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/launchpad_pool.h"
+
+#include <unistd.h>
+
+#include <magenta/syscalls.h>
+
+#include "lib/ftl/logging.h"
+#include "mojo/application_manager/worker_pool.h"
+
+namespace mojo {
+namespace {
+
+// The name of a pooled process until it is given to an application.
+constexpr char kPooledProcessName[] = "application_manager:pooled";
+
+}  // namespace
+
+LaunchpadPool::LaunchpadPool(size_t capacity, WorkerPool* refill_pool)
+    : capacity_(capacity), refill_pool_(refill_pool) {
+  FTL_DCHECK(refill_pool_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ScheduleRefillLocked();
+}
+
+LaunchpadPool::~LaunchpadPool() {
+  for (launchpad_t* lp : launchpads_)
+    launchpad_destroy(lp);
+}
+
+launchpad_t* LaunchpadPool::CreateLaunchpad(const char* name) {
+  launchpad_t* lp = nullptr;
+  if (launchpad_create(name, &lp) != NO_ERROR)
+    return nullptr;
+  // TODO(abarth): We shouldn't pass stdin, stdout, stderr, or the file system
+  // when launching Mojo applications. We probably shouldn't pass environ, but
+  // currently this is very useful as a way to tell the loader in the child
+  // process to print out load addresses so we can understand crashes.
+  mx_status_t status = launchpad_load_vdso(lp, MX_HANDLE_INVALID);
+  if (status == NO_ERROR)
+    status = launchpad_add_vdso_vmo(lp);
+  if (status == NO_ERROR)
+    status = launchpad_environ(lp, environ);
+  if (status == NO_ERROR)
+    status = launchpad_add_all_mxio(lp);
+  if (status != NO_ERROR) {
+    launchpad_destroy(lp);
+    return nullptr;
+  }
+  return lp;
+}
+
+launchpad_t* LaunchpadPool::Take() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!launchpads_.empty()) {
+      launchpad_t* lp = launchpads_.back();
+      launchpads_.pop_back();
+      ScheduleRefillLocked();
+      return lp;
+    }
+    ScheduleRefillLocked();
+  }
+  return CreateLaunchpad(kPooledProcessName);
+}
+
+void LaunchpadPool::ScheduleRefillLocked() {
+  if (refill_pending_ || launchpads_.size() >= capacity_ ||
+      refill_pool_->IsShuttingDown())
+    return;
+  refill_pending_ = true;
+  // Launches waiting on the same threads matter more than a full pool.
+  refill_pool_->PostTask([this] { Refill(); }, WorkerPool::Priority::kLow);
+}
+
+void LaunchpadPool::Refill() {
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Processes created now would only be destroyed with this object.
+      if (launchpads_.size() >= capacity_ || refill_pool_->IsShuttingDown()) {
+        refill_pending_ = false;
+        return;
+      }
+    }
+    launchpad_t* lp = CreateLaunchpad(kPooledProcessName);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!lp) {
+      // Try again on the next launch rather than spinning.
+      refill_pending_ = false;
+      return;
+    }
+    launchpads_.push_back(lp);
+  }
+}
+
+}  // namespace mojo
@@ -0,0 +1,59 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_LAUNCHPAD_POOL_H_
+#define MOJO_APPLICATION_MANAGER_LAUNCHPAD_POOL_H_
+
+#include <launchpad/launchpad.h>
+
+#include <mutex>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+
+namespace mojo {
+class WorkerPool;
+
+// Keeps a few launchpads ready for launching native applications. Each one
+// already has its process created and everything that does not depend on the
+// application loaded: the vDSO, the environment and the mxio handles. A launch
+// only has to load the executable, add its arguments and handles, and start.
+//
+// Magenta cannot fork, so the processes cannot go any further than this
+// before they know which executable they will run.
+//
+// Taken launchpads are replaced in the background on |refill_pool|. The
+// refills queued there use this object, so |refill_pool| must be destroyed
+// (which runs what is queued) before this object is. Once it is shutting down,
+// taken launchpads are no longer replaced. May be used from any thread.
+class LaunchpadPool {
+ public:
+  LaunchpadPool(size_t capacity, WorkerPool* refill_pool);
+  ~LaunchpadPool();
+
+  // Creates a launchpad prepared as described above, or returns null on
+  // failure. The process is named |name|.
+  static launchpad_t* CreateLaunchpad(const char* name);
+
+  // Returns a prepared launchpad, creating one if the pool is empty, or null on
+  // failure. The caller must name the process and destroy the launchpad.
+  launchpad_t* Take();
+
+ private:
+  void ScheduleRefillLocked();
+  void Refill();
+
+  const size_t capacity_;
+  WorkerPool* const refill_pool_;
+
+  std::mutex mutex_;
+  std::vector<launchpad_t*> launchpads_;
+  bool refill_pending_ = false;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LaunchpadPool);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_LAUNCHPAD_POOL_H_
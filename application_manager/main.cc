@@ -7,30 +7,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
-#include "lib/ftl/files/file.h"
 #include "lib/mtl/tasks/message_loop.h"
 #include "mojo/application_manager/application_manager.h"
 #include "mojo/application_manager/command_listener.h"
+#include "mojo/application_manager/config_watcher.h"
 #include "mojo/application_manager/startup_config.h"
+#include "mojo/application_manager/startup_config_image.h"
 
 constexpr char kDefaultConfigPath[] =
     "/system/data/application_manager/startup.config";
 
-static void LoadStartupConfig(mojo::StartupConfig* config,
-                              const std::string& config_path) {
-  std::string data;
-  if (!files::ReadFileToString(config_path, &data)) {
-    fprintf(stderr, "application_manager: Failed to read startup config: %s\n",
-            config_path.c_str());
-  } else if (!config->Parse(data)) {
-    fprintf(stderr, "application_manager: Failed to parse startup config: %s\n",
-            config_path.c_str());
-  }
-}
+// The application manager that devmgr starts serves the launcher channel,
+// which it is handed as argument 0. A later invocation may be handed a client
+// end of that channel as argument 1 by whoever starts it, and then hands its
+// command to the running application manager rather than starting a second
+// copy of every application it runs.
+constexpr uint32_t kRunningManagerHandle =
+    MX_HND_INFO(MX_HND_TYPE_APPLICATION_LAUNCHER, 1);
 
 int main(int argc, char** argv) {
   auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
@@ -39,46 +38,116 @@ int main(int argc, char** argv) {
   command_line.GetOptionValue("config", &config_path);
 
   const auto& positional_args = command_line.positional_args();
+
+  // "--standalone" runs a separate application manager regardless.
+  mojo::ScopedMessagePipeHandle running_manager(
+      mojo::MessagePipeHandle(mxio_get_startup_handle(kRunningManagerHandle)));
+  if (running_manager.is_valid() && !command_line.HasOption("standalone")) {
+    bool succeeded = false;
+    if (!config_path.empty()) {
+      // The running application manager keeps its own config, so a config
+      // given here could only be ignored.
+      if (mojo::ForwardCommand(running_manager.get(), {}, &succeeded)) {
+        fprintf(stderr,
+                "application_manager: Already running, so --config cannot be "
+                "applied; use --standalone to run another\n");
+        return 1;
+      }
+    } else if (mojo::ForwardCommand(running_manager.get(), positional_args,
+                                    &succeeded)) {
+      if (positional_args.empty()) {
+        fprintf(stderr, "application_manager: Already running\n");
+        return 1;
+      }
+      return succeeded ? 0 : 1;
+    }
+  }
+  running_manager.reset();
+
   if (config_path.empty() && positional_args.empty())
     config_path = kDefaultConfigPath;
 
   std::vector<std::string> initial_apps;
   mojo::ApplicationArgs args_for;
+  mojo::ApplicationDependencies depends_on;
+  mojo::ReapingPolicy reaping_policy;
+  std::unordered_set<std::string> instance_per_query;
+  std::string tracing_app;
+  std::string connection_profile;
+  std::unordered_map<std::string, mojo::ContentHandlerPool::Options>
+      content_handlers;
+  std::unique_ptr<mojo::StartupConfigImage> config_image;
   if (!config_path.empty()) {
     mojo::StartupConfig config;
-    LoadStartupConfig(&config, config_path);
+    // The image is checked against the config once the loop is running; see
+    // |ConfigWatcher::Start|.
+    mojo::LoadStartupConfig(config_path, false, &config, &config_image);
     initial_apps = config.TakeInitialApps();
     args_for = config.TakeArgsFor();
+    depends_on = config.TakeDependsOn();
+    reaping_policy = config.TakeReapingPolicy();
+    instance_per_query = config.TakeInstancePerQuery();
+    tracing_app = config.tracing_app();
+    connection_profile = config.connection_profile();
+    content_handlers = config.TakeContentHandlers();
   }
 
+  mojo::ApplicationArgs command_line_args;
   if (!positional_args.empty()) {
     // TODO(alhaad): This implementation passes all the command-line arguments
     // to the initial application. Having an '--args-for' option is desirable.
     std::string initial_app = positional_args[0];
     initial_apps.push_back(initial_app);
-    args_for[initial_app] = std::vector<std::string>(
+    command_line_args[initial_app] = std::vector<std::string>(
         positional_args.begin() + 1, positional_args.end());
+    args_for[initial_app] = command_line_args[initial_app];
   }
 
-  // TODO(jeffbrown): If there's already a running instance of
-  // application_manager, it might be nice to pass the request over to
-  // it instead of starting a whole new instance.  Alternately, we could create
-  // a separate command-line program to act as an interface for modifying
-  // configuration, starting / stopping applications, listing what's running,
-  // printing debugging information, etc.  Having multiple instances of
-  // application manager running is not what we want, in general.
+  // TODO(jeffbrown): It might be nice to have a separate command-line program
+  // to act as an interface for modifying configuration, starting / stopping
+  // applications, listing what's running, printing debugging information, etc.
 
   mtl::MessageLoop message_loop;
-  mojo::ApplicationManager manager(std::move(args_for));
+  mojo::ApplicationManager manager(std::move(args_for),
+                                  std::move(instance_per_query));
   mojo::CommandListener command_listener(&manager);
+  manager.SetConfigImage(std::move(config_image));
+  manager.SetContentHandlerPools(content_handlers);
 
-  if (!initial_apps.empty()) {
-    message_loop.task_runner()->PostTask([&manager, &initial_apps] {
-      for (const std::string& app : initial_apps)
-        manager.GetOrStartApplicationInstance(app);
+  // Applies changes to the config without restarting the applications.
+  std::unique_ptr<mojo::ConfigWatcher> config_watcher;
+  if (!config_path.empty()) {
+    config_watcher = std::make_unique<mojo::ConfigWatcher>(
+        config_path, std::move(command_line_args), &manager);
+    config_watcher->Start();
+    command_listener.set_reload_config_callback(
+        [&config_watcher] { config_watcher->Reload(); });
+  }
+
+  message_loop.task_runner()->PostTask([&manager, &reaping_policy] {
+    manager.SetReapingPolicy(std::move(reaping_policy));
+  });
+
+  if (!tracing_app.empty()) {
+    message_loop.task_runner()->PostTask([&manager, &tracing_app] {
+      manager.RegisterWithTracing(tracing_app);
+    });
+  }
+
+  if (!connection_profile.empty()) {
+    message_loop.task_runner()->PostTask([&manager, &connection_profile] {
+      manager.EnablePrelaunching(connection_profile);
     });
   }
 
+  if (!initial_apps.empty()) {
+    message_loop.task_runner()->PostTask(
+        [&manager, &initial_apps, &depends_on] {
+          manager.StartInitialApplications(std::move(initial_apps),
+                                           depends_on);
+        });
+  }
+
   message_loop.task_runner()->PostTask([&command_listener] {
     mojo::ScopedMessagePipeHandle launcher(mojo::MessagePipeHandle(
         mxio_get_startup_handle(MX_HND_TYPE_APPLICATION_LAUNCHER)));
@@ -0,0 +1,25 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/process_memory.h"
+
+#include <magenta/syscalls.h>
+#include <magenta/syscalls/object.h>
+
+namespace mojo {
+
+uint64_t GetProcessMemoryUsage(mx_handle_t process) {
+  if (process == MX_HANDLE_INVALID)
+    return 0u;
+  mx_info_task_stats_t info;
+  mx_size_t actual;
+  mx_status_t status =
+      mx_object_get_info(process, MX_INFO_TASK_STATS, sizeof(info.rec), &info,
+                         sizeof(info), &actual);
+  if (status < 0)
+    return 0u;
+  return info.rec.mem_committed_bytes;
+}
+
+}  // namespace mojo
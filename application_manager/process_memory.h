@@ -0,0 +1,20 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_PROCESS_MEMORY_H_
+#define MOJO_APPLICATION_MANAGER_PROCESS_MEMORY_H_
+
+#include <magenta/types.h>
+#include <stdint.h>
+
+namespace mojo {
+
+// Returns the memory committed to |process|, in bytes, or zero if it is not
+// known. Applications run by a content handler have no process of their own,
+// so their memory is counted against the content handler.
+uint64_t GetProcessMemoryUsage(mx_handle_t process);
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_PROCESS_MEMORY_H_
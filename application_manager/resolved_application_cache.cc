@@ -0,0 +1,80 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/resolved_application_cache.h"
+
+#include <utility>
+
+namespace mojo {
+namespace {
+
+// Entries are keyed by path, so there are at most as many as there are
+// application files. The bound only keeps a stream of distinct bogus
+// file:// names from growing the cache without limit.
+constexpr size_t kMaxEntries = 512;
+
+}  // namespace
+
+ResolvedApplication::ResolvedApplication() = default;
+
+ResolvedApplication::ResolvedApplication(const struct stat& info,
+                                         std::string content_handler)
+    : device(info.st_dev),
+      inode(info.st_ino),
+      size(info.st_size),
+      modification_time(info.st_mtim),
+      content_handler(std::move(content_handler)) {}
+
+ResolvedApplication::~ResolvedApplication() = default;
+
+bool ResolvedApplication::IsSameFile(const struct stat& info) const {
+  return device == info.st_dev && inode == info.st_ino &&
+         size == info.st_size &&
+         modification_time.tv_sec == info.st_mtim.tv_sec &&
+         modification_time.tv_nsec == info.st_mtim.tv_nsec;
+}
+
+ResolvedApplicationCache::ResolvedApplicationCache() = default;
+
+ResolvedApplicationCache::~ResolvedApplicationCache() = default;
+
+bool ResolvedApplicationCache::Lookup(const std::string& path,
+                                      const struct stat& info,
+                                      std::string* content_handler) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(path);
+  if (it == entries_.end())
+    return false;
+  if (!it->second.IsSameFile(info)) {
+    entries_.erase(it);
+    return false;
+  }
+  *content_handler = it->second.content_handler;
+  return true;
+}
+
+void ResolvedApplicationCache::Store(const std::string& path,
+                                     ResolvedApplication resolved) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(path);
+  if (it != entries_.end()) {
+    it->second = std::move(resolved);
+    return;
+  }
+  if (entries_.size() >= kMaxEntries)
+    entries_.erase(entries_.begin());
+  entries_.emplace(path, std::move(resolved));
+}
+
+void ResolvedApplicationCache::Erase(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.erase(path);
+}
+
+size_t ResolvedApplicationCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+}  // namespace mojo
@@ -0,0 +1,74 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_RESOLVED_APPLICATION_CACHE_H_
+#define MOJO_APPLICATION_MANAGER_RESOLVED_APPLICATION_CACHE_H_
+
+#include <sys/stat.h>
+#include <time.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "lib/ftl/macros.h"
+
+namespace mojo {
+
+// How an application file was classified the last time it was launched.
+struct ResolvedApplication {
+  ResolvedApplication();
+  ResolvedApplication(const struct stat& info, std::string content_handler);
+  ~ResolvedApplication();
+
+  // Whether |info| describes the same, unmodified file that was classified.
+  // Modification times are compared to the nanosecond, so a file rewritten
+  // within the same second is not mistaken for the old one.
+  bool IsSameFile(const struct stat& info) const;
+
+  // The identity of the file when it was classified.
+  dev_t device = 0;
+  ino_t inode = 0;
+  off_t size = 0;
+  struct timespec modification_time = {};
+
+  // The content handler named by the file's mojo magic, or empty if the file
+  // is a native executable.
+  std::string content_handler;
+};
+
+// Remembers how application files were classified, by path, so that repeated
+// launches of the same application do not read and rewind the file again to
+// tell a native executable from content. Entries are checked against the
+// identity of the file that is opened for the launch, so a file that has been
+// replaced or modified is classified afresh.
+//
+// May be used from any thread.
+class ResolvedApplicationCache {
+ public:
+  ResolvedApplicationCache();
+  ~ResolvedApplicationCache();
+
+  // Returns whether there is an entry for |path| that still describes the file
+  // that |info| was read from, copying the content handler it names to
+  // |*content_handler| if so. An entry that no longer matches is dropped.
+  bool Lookup(const std::string& path,
+              const struct stat& info,
+              std::string* content_handler);
+
+  void Store(const std::string& path, ResolvedApplication resolved);
+  void Erase(const std::string& path);
+
+  size_t size() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, ResolvedApplication> entries_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ResolvedApplicationCache);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_RESOLVED_APPLICATION_CACHE_H_
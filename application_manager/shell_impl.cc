@@ -8,8 +8,8 @@
 
 namespace mojo {
 
-ShellImpl::ShellImpl(std::string application_name, ApplicationManager* manager)
-    : binding_(this), connector_(std::move(application_name), manager) {}
+ShellImpl::ShellImpl(ApplicationId application_id, ApplicationManager* manager)
+    : binding_(this), connector_(application_id, manager) {}
 
 ShellImpl::~ShellImpl() {}
 
@@ -14,7 +14,7 @@ class ApplicationManager;
 
 class ShellImpl : public Shell {
  public:
-  ShellImpl(std::string application_name, ApplicationManager* manager);
+  ShellImpl(ApplicationId application_id, ApplicationManager* manager);
   ~ShellImpl();
 
   const std::string& name() const { return connector_.name(); }
@@ -4,15 +4,163 @@
 
 #include "mojo/application_manager/startup_config.h"
 
+#include <stdio.h>
+
+#include <limits>
 #include <utility>
 
 #include <rapidjson/document.h>
 
+#include "lib/ftl/files/file.h"
+
 namespace mojo {
 namespace {
 
+constexpr char kConfigImageSuffix[] = ".bin";
+
 constexpr char kInitialApps[] = "initial-apps";
 constexpr char kArgsFor[] = "args-for";
+constexpr char kDependsOn[] = "depends-on";
+constexpr char kIdleTimeout[] = "idle-timeout";
+constexpr char kIdleTimeoutFor[] = "idle-timeout-for";
+constexpr char kKeepAlive[] = "keep-alive";
+constexpr char kMemoryBudgetMb[] = "memory-budget-mb";
+
+constexpr char kInstancePerQuery[] = "instance-per-query";
+constexpr char kTracingApp[] = "tracing-app";
+constexpr char kContentHandlers[] = "content-handlers";
+constexpr char kConnectionProfile[] = "connection-profile";
+constexpr char kMaxInstances[] = "max-instances";
+constexpr char kMaxLoad[] = "max-load";
+constexpr char kPolicy[] = "policy";
+constexpr char kLeastLoaded[] = "least-loaded";
+constexpr char kConsistentHash[] = "consistent-hash";
+
+constexpr uint64_t kBytesPerMegabyte = 1024 * 1024;
+
+// Timeouts longer than a year are almost certainly mistakes, and much longer
+// ones do not fit in a |ftl::TimeDelta|.
+constexpr double kMaxSeconds = 365.0 * 24 * 60 * 60;
+
+bool ParseContentHandlerOptions(const rapidjson::Value& value,
+                                ContentHandlerPool::Options* options) {
+  if (!value.IsObject())
+    return false;
+  auto max_instances_it = value.FindMember(kMaxInstances);
+  if (max_instances_it != value.MemberEnd()) {
+    if (!max_instances_it->value.IsUint() ||
+        max_instances_it->value.GetUint() == 0)
+      return false;
+    options->max_instances = max_instances_it->value.GetUint();
+  }
+  auto max_load_it = value.FindMember(kMaxLoad);
+  if (max_load_it != value.MemberEnd()) {
+    if (!max_load_it->value.IsUint() || max_load_it->value.GetUint() == 0)
+      return false;
+    options->max_load = max_load_it->value.GetUint();
+  }
+  auto policy_it = value.FindMember(kPolicy);
+  if (policy_it != value.MemberEnd()) {
+    if (!policy_it->value.IsString())
+      return false;
+    std::string policy = policy_it->value.GetString();
+    if (policy == kLeastLoaded)
+      options->policy = ContentHandlerPool::Policy::kLeastLoaded;
+    else if (policy == kConsistentHash)
+      options->policy = ContentHandlerPool::Policy::kConsistentHash;
+    else
+      return false;
+  }
+  return true;
+}
+
+// Parses an array of application names.
+bool ParseNameSet(const rapidjson::Value& value,
+                  std::unordered_set<std::string>* names) {
+  if (!value.IsArray())
+    return false;
+  for (const auto& application_name : value.GetArray()) {
+    if (!application_name.IsString())
+      return false;
+    names->insert(application_name.GetString());
+  }
+  return true;
+}
+
+// Parses a non-negative number of seconds, up to |kMaxSeconds|.
+bool ParseSeconds(const rapidjson::Value& value, ftl::TimeDelta* result) {
+  // Written so that NaN fails too.
+  if (!value.IsNumber() ||
+      !(value.GetDouble() >= 0 && value.GetDouble() <= kMaxSeconds))
+    return false;
+  *result = ftl::TimeDelta::FromMilliseconds(
+      static_cast<int64_t>(value.GetDouble() * 1000));
+  return true;
+}
+
+// Parses a number of megabytes into bytes, rejecting sizes that do not fit.
+bool ParseMegabytes(const rapidjson::Value& value, uint64_t* bytes) {
+  if (!value.IsUint64() ||
+      value.GetUint64() >
+          std::numeric_limits<uint64_t>::max() / kBytesPerMegabyte)
+    return false;
+  *bytes = value.GetUint64() * kBytesPerMegabyte;
+  return true;
+}
+
+bool ParseReapingPolicy(const rapidjson::Document& document,
+                        ReapingPolicy* policy) {
+  auto idle_timeout_it = document.FindMember(kIdleTimeout);
+  if (idle_timeout_it != document.MemberEnd() &&
+      !ParseSeconds(idle_timeout_it->value, &policy->default_idle_timeout))
+    return false;
+
+  auto idle_timeout_for_it = document.FindMember(kIdleTimeoutFor);
+  if (idle_timeout_for_it != document.MemberEnd()) {
+    const auto& value = idle_timeout_for_it->value;
+    if (!value.IsObject())
+      return false;
+    for (const auto& entry : value.GetObject()) {
+      ftl::TimeDelta timeout;
+      if (!entry.name.IsString() || !ParseSeconds(entry.value, &timeout))
+        return false;
+      policy->idle_timeouts.emplace(entry.name.GetString(), timeout);
+    }
+  }
+
+  auto keep_alive_it = document.FindMember(kKeepAlive);
+  if (keep_alive_it != document.MemberEnd() &&
+      !ParseNameSet(keep_alive_it->value, &policy->keep_alive))
+    return false;
+
+  auto memory_budget_it = document.FindMember(kMemoryBudgetMb);
+  if (memory_budget_it != document.MemberEnd() &&
+      !ParseMegabytes(memory_budget_it->value, &policy->memory_budget))
+    return false;
+
+  return true;
+}
+
+// Parses an object mapping application names to arrays of strings.
+bool ParseStringListMap(
+    const rapidjson::Value& value,
+    std::unordered_map<std::string, std::vector<std::string>>* map) {
+  if (!value.IsObject())
+    return false;
+  for (const auto& entry : value.GetObject()) {
+    if (!entry.name.IsString() || !entry.value.IsArray())
+      return false;
+    std::string application_name = entry.name.GetString();
+    std::vector<std::string> strings;
+    for (const auto& string : entry.value.GetArray()) {
+      if (!string.IsString())
+        return false;
+      strings.push_back(string.GetString());
+    }
+    map->emplace(std::move(application_name), std::move(strings));
+  }
+  return true;
+}
 
 }  // namespace
 
@@ -23,6 +171,12 @@ StartupConfig::~StartupConfig() = default;
 bool StartupConfig::Parse(const std::string& string) {
   initial_apps_.clear();
   args_for_.clear();
+  depends_on_.clear();
+  reaping_policy_ = ReapingPolicy();
+  instance_per_query_.clear();
+  tracing_app_.clear();
+  content_handlers_.clear();
+  connection_profile_.clear();
 
   rapidjson::Document document;
   document.Parse(string.data(), string.size());
@@ -42,27 +196,63 @@ bool StartupConfig::Parse(const std::string& string) {
   }
 
   auto args_for_it = document.FindMember(kArgsFor);
-  if (args_for_it != document.MemberEnd()) {
-    const auto& value = args_for_it->value;
+  if (args_for_it != document.MemberEnd() &&
+      !ParseStringListMap(args_for_it->value, &args_for_))
+    return false;
+
+  auto depends_on_it = document.FindMember(kDependsOn);
+  if (depends_on_it != document.MemberEnd() &&
+      !ParseStringListMap(depends_on_it->value, &depends_on_))
+    return false;
+
+  if (!ParseReapingPolicy(document, &reaping_policy_))
+    return false;
+
+  auto instance_per_query_it = document.FindMember(kInstancePerQuery);
+  if (instance_per_query_it != document.MemberEnd() &&
+      !ParseNameSet(instance_per_query_it->value, &instance_per_query_))
+    return false;
+
+  auto tracing_app_it = document.FindMember(kTracingApp);
+  if (tracing_app_it != document.MemberEnd()) {
+    if (!tracing_app_it->value.IsString())
+      return false;
+    tracing_app_ = tracing_app_it->value.GetString();
+  }
+
+  auto connection_profile_it = document.FindMember(kConnectionProfile);
+  if (connection_profile_it != document.MemberEnd()) {
+    if (!connection_profile_it->value.IsString())
+      return false;
+    connection_profile_ = connection_profile_it->value.GetString();
+  }
+
+  auto content_handlers_it = document.FindMember(kContentHandlers);
+  if (content_handlers_it != document.MemberEnd()) {
+    const auto& value = content_handlers_it->value;
     if (!value.IsObject())
       return false;
-    for (const auto& command : value.GetObject()) {
-      if (!command.name.IsString() || !command.value.IsArray())
+    for (const auto& entry : value.GetObject()) {
+      ContentHandlerPool::Options options;
+      if (!entry.name.IsString() ||
+          !ParseContentHandlerOptions(entry.value, &options))
         return false;
-      std::string application_name = command.name.GetString();
-      std::vector<std::string> args;
-      for (const auto& arg : command.value.GetArray()) {
-        if (!arg.IsString())
-          return false;
-        args.push_back(arg.GetString());
-      }
-      args_for_.emplace(std::move(application_name), std::move(args));
+      content_handlers_.emplace(entry.name.GetString(), options);
     }
   }
 
   return true;
 }
 
+bool StartupConfig::ParseImage(const StartupConfigImage& image) {
+  if (!Parse(image.options().ToString()))
+    return false;
+  initial_apps_ = image.GetInitialApps();
+  for (size_t i = 0; i < image.num_depends_on(); ++i)
+    depends_on_[image.GetDependsOnName(i).ToString()] = image.GetDependsOn(i);
+  return true;
+}
+
 ApplicationArgs StartupConfig::TakeArgsFor() {
   return std::move(args_for_);
 }
@@ -71,4 +261,78 @@ std::vector<std::string> StartupConfig::TakeInitialApps() {
   return std::move(initial_apps_);
 }
 
+ApplicationDependencies StartupConfig::TakeDependsOn() {
+  return std::move(depends_on_);
+}
+
+ReapingPolicy StartupConfig::TakeReapingPolicy() {
+  return std::move(reaping_policy_);
+}
+
+std::unordered_set<std::string> StartupConfig::TakeInstancePerQuery() {
+  return std::move(instance_per_query_);
+}
+
+std::unordered_map<std::string, ContentHandlerPool::Options>
+StartupConfig::TakeContentHandlers() {
+  return std::move(content_handlers_);
+}
+
+std::string GetStartupConfigImagePath(const std::string& config_path) {
+  return config_path + kConfigImageSuffix;
+}
+
+bool LoadStartupConfig(const std::string& config_path,
+                       bool verify_image,
+                       StartupConfig* config,
+                       std::unique_ptr<StartupConfigImage>* image) {
+  image->reset();
+  std::string image_path = GetStartupConfigImagePath(config_path);
+  *image = StartupConfigImage::Open(image_path);
+  // The config's hash tells whether the image was compiled from this version
+  // of it, however the two files' times compare, but reading and hashing the
+  // config is only worth it if the image might be stale.
+  std::string data;
+  bool has_data = false;
+  if (!*image || verify_image) {
+    has_data = files::ReadFileToString(config_path, &data);
+    if (*image && has_data &&
+        (*image)->config_hash() != StartupConfigImage::HashConfig(data))
+      image->reset();
+  }
+  if (*image) {
+    if (config->ParseImage(**image))
+      return true;
+    fprintf(stderr,
+            "application_manager: Failed to parse startup config image: %s\n",
+            image_path.c_str());
+    image->reset();
+    if (!has_data)
+      has_data = files::ReadFileToString(config_path, &data);
+  }
+
+  if (!has_data) {
+    fprintf(stderr, "application_manager: Failed to read startup config: %s\n",
+            config_path.c_str());
+    return false;
+  }
+  if (!config->Parse(data)) {
+    fprintf(stderr, "application_manager: Failed to parse startup config: %s\n",
+            config_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool IsStartupConfigImageStale(const std::string& config_path) {
+  std::unique_ptr<StartupConfigImage> image =
+      StartupConfigImage::Open(GetStartupConfigImagePath(config_path));
+  if (!image)
+    return false;
+  std::string data;
+  if (!files::ReadFileToString(config_path, &data))
+    return false;
+  return image->config_hash() != StartupConfigImage::HashConfig(data);
+}
+
 }  // namespace mojo
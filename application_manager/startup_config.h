@@ -5,12 +5,17 @@
 #ifndef MOJO_APPLICATION_MANAGER_STARTUP_CONFIG_H_
 #define MOJO_APPLICATION_MANAGER_STARTUP_CONFIG_H_
 
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "lib/ftl/macros.h"
 #include "mojo/application_manager/application_manager.h"
+#include "mojo/application_manager/application_reaper.h"
+#include "mojo/application_manager/content_handler_pool.h"
+#include "mojo/application_manager/startup_config_image.h"
 
 namespace mojo {
 
@@ -21,8 +26,72 @@ namespace mojo {
 //   ],
 //   "args-for": {
 //     "mojo:example_app": ["user1"]
+//   },
+//   "depends-on": {
+//     "mojo:device_runner": ["mojo:example_app"]
+//   },
+//   "idle-timeout": 600,
+//   "idle-timeout-for": {
+//     "mojo:example_app": 30
+//   },
+//   "keep-alive": [
+//     "mojo:example_service"
+//   ],
+//   "memory-budget-mb": 256,
+//   "instance-per-query": [
+//     "mojo:example_viewer"
+//   ],
+//   "tracing-app": "mojo:tracing",
+//   "connection-profile": "/data/application_manager/connections.json",
+//   "content-handlers": {
+//     "mojo:example_content_handler": {
+//       "max-instances": 4,
+//       "max-load": 4,
+//       "policy": "least-loaded"
+//     }
 //   }
 // }
+//
+// Initial applications are launched concurrently, except that an application
+// listed in "depends-on" is not launched until the applications it depends on
+// have been.
+//
+// Applications that have neither been given a connection nor connected to
+// another application for "idle-timeout" seconds, or for their own
+// "idle-timeout-for" entry, are asked to quit. When the applications
+// together use more than "memory-budget-mb", the least recently used are asked
+// to quit. Neither applies to the initial applications, to those listed in
+// "keep-alive", or to content handlers that are running applications. All of
+// these are optional; by default, applications run until they quit on their
+// own.
+//
+// Names that differ only in their query (e.g., "mojo:example_viewer?a" and
+// "mojo:example_viewer?b") share one instance, unless the application is
+// listed in "instance-per-query".
+//
+// If "tracing-app" is given, the application manager registers with it as a
+// trace provider and traces the timeline of each application launch.
+//
+// The applications run by a content handler listed in "content-handlers" are
+// spread over up to "max-instances" instances of it, either to the least
+// loaded instance ("least-loaded", the default) or by hashing their URL
+// ("consistent-hash"). With "least-loaded", another instance is only started
+// once every running one runs "max-load" applications (4 by default).
+//
+// If "connection-profile" is given, the application manager records in that
+// file which applications each application connects to as it starts up, and
+// starts them along with it on later launches.
+//
+// A config can also be compiled at build time (see startup_config.gni) into an
+// image that is mapped instead of parsed. The application manager looks for
+// the image next to the config, with ".bin" appended to its name, and uses it
+// only if it was compiled from the config as it is now. The image records a
+// hash of the config's contents to tell.
+//
+// The application manager reloads the config when it changes, or when it is
+// sent the "reload-config" command, and applies the differences without
+// restarting the applications that are running (see
+// |ApplicationManager::ApplyStartupConfig|).
 
 class StartupConfig {
  public:
@@ -31,16 +100,56 @@ class StartupConfig {
 
   bool Parse(const std::string& string);
 
+  // Reads the config from a compiled image. The arguments are not copied out
+  // of the image; the application manager looks them up in it as it needs
+  // them (see |ApplicationManager::SetConfigImage|).
+  bool ParseImage(const StartupConfigImage& image);
+
   ApplicationArgs TakeArgsFor();
   std::vector<std::string> TakeInitialApps();
+  ApplicationDependencies TakeDependsOn();
+  ReapingPolicy TakeReapingPolicy();
+  std::unordered_set<std::string> TakeInstancePerQuery();
+  const std::string& tracing_app() const { return tracing_app_; }
+  const std::string& connection_profile() const { return connection_profile_; }
+  std::unordered_map<std::string, ContentHandlerPool::Options>
+  TakeContentHandlers();
 
  private:
   ApplicationArgs args_for_;
+  ApplicationDependencies depends_on_;
+  ReapingPolicy reaping_policy_;
+  std::unordered_set<std::string> instance_per_query_;
+  std::string tracing_app_;
+  std::string connection_profile_;
+  std::unordered_map<std::string, ContentHandlerPool::Options>
+      content_handlers_;
   std::vector<std::string> initial_apps_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(StartupConfig);
 };
 
+// Where the compiled image of the config at |config_path| is looked for.
+std::string GetStartupConfigImagePath(const std::string& config_path);
+
+// Loads the config at |config_path| into |config|. If the config has a valid
+// compiled image, the image is loaded instead and |*image| is set to it. If
+// |verify_image|, the image is used only if the hash it records matches the
+// config's contents; if not, the config is not even read, so that startup
+// does not pay for it, and the caller should check the image later with
+// |IsStartupConfigImageStale|. Returns false, after reporting why, if the
+// config could not be read or parsed, in which case |config| may have been
+// partly filled in.
+bool LoadStartupConfig(const std::string& config_path,
+                       bool verify_image,
+                       StartupConfig* config,
+                       std::unique_ptr<StartupConfigImage>* image);
+
+// Whether the config at |config_path| has a compiled image that was compiled
+// from a different version of it. Reads and hashes the whole config, so
+// should not be called on the message loop.
+bool IsStartupConfigImageStale(const std::string& config_path);
+
 }  // namespace mojo
 
 #endif  // MOJO_APPLICATION_MANAGER_STARTUP_CONFIG_H_
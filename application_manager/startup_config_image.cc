@@ -0,0 +1,254 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/startup_config_image.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "lib/ftl/files/unique_fd.h"
+#include "lib/ftl/logging.h"
+
+namespace mojo {
+namespace {
+
+constexpr char kMagic[8] = {'M', 'O', 'J', 'O', 'S', 'C', 'F', 'G'};
+constexpr uint32_t kVersion = 2;
+
+constexpr uint32_t kFnvOffsetBasis = 2166136261u;
+constexpr uint32_t kFnvPrime = 16777619u;
+
+}  // namespace
+
+// Keep in sync with compile_startup_config.py.
+struct StartupConfigImage::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t size;
+  uint32_t initial_apps_offset;
+  uint32_t num_initial_apps;
+  uint32_t args_for_offset;
+  uint32_t num_args_for;
+  uint32_t depends_on_offset;
+  uint32_t num_depends_on;
+  uint32_t list_items_offset;
+  uint32_t num_list_items;
+  uint32_t strings_offset;
+  uint32_t strings_size;
+  uint32_t options_offset;
+  uint32_t options_length;
+  uint32_t config_hash;
+};
+
+struct StartupConfigImage::StringRef {
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct StartupConfigImage::ListEntry {
+  StringRef name;
+  uint32_t first_item;
+  uint32_t num_items;
+};
+
+StartupConfigImage::StartupConfigImage(const uint8_t* data,
+                                       size_t size,
+                                       bool mapped)
+    : data_(data), size_(size), mapped_(mapped) {}
+
+StartupConfigImage::~StartupConfigImage() {
+  if (mapped_)
+    munmap(const_cast<uint8_t*>(data_), size_);
+  else
+    delete[] data_;
+}
+
+std::unique_ptr<StartupConfigImage> StartupConfigImage::Open(
+    const std::string& path) {
+  ftl::UniqueFD fd(open(path.c_str(), O_RDONLY));
+  if (!fd.is_valid())
+    return nullptr;
+  struct stat info;
+  if (fstat(fd.get(), &info) != 0 || info.st_size < 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(Header))
+    return nullptr;
+  size_t size = static_cast<size_t>(info.st_size);
+
+  std::unique_ptr<StartupConfigImage> image;
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+  if (mapping != MAP_FAILED) {
+    image.reset(new StartupConfigImage(static_cast<const uint8_t*>(mapping),
+                                       size, true));
+  } else {
+    // Not every file system can map files; reading is slower but works.
+    uint8_t* buffer = new uint8_t[size];
+    size_t total = 0;
+    while (total < size) {
+      ssize_t count = read(fd.get(), buffer + total, size - total);
+      if (count <= 0)
+        break;
+      total += static_cast<size_t>(count);
+    }
+    image.reset(new StartupConfigImage(buffer, size, false));
+    if (total != size)
+      return nullptr;
+  }
+
+  if (!image->IsValid()) {
+    FTL_LOG(WARNING) << "Ignoring invalid startup config image: " << path;
+    return nullptr;
+  }
+  return image;
+}
+
+std::vector<std::string> StartupConfigImage::GetInitialApps() const {
+  const StringRef* refs = reinterpret_cast<const StringRef*>(
+      data_ + header()->initial_apps_offset);
+  std::vector<std::string> result;
+  result.reserve(header()->num_initial_apps);
+  for (uint32_t i = 0; i < header()->num_initial_apps; ++i)
+    result.push_back(GetString(refs[i]).ToString());
+  return result;
+}
+
+bool StartupConfigImage::FindArgsFor(ftl::StringView name,
+                                     std::vector<std::string>* args) const {
+  const ListEntry* begin = args_for();
+  const ListEntry* end = begin + header()->num_args_for;
+  const ListEntry* it = std::lower_bound(
+      begin, end, name, [this](const ListEntry& entry, ftl::StringView key) {
+        return GetString(entry.name) < key;
+      });
+  if (it == end || GetString(it->name) != name)
+    return false;
+  *args = GetListItems(*it);
+  return true;
+}
+
+size_t StartupConfigImage::num_args_for() const {
+  return header()->num_args_for;
+}
+
+ftl::StringView StartupConfigImage::GetArgsForName(size_t index) const {
+  FTL_DCHECK(index < num_args_for());
+  return GetString(args_for()[index].name);
+}
+
+size_t StartupConfigImage::num_depends_on() const {
+  return header()->num_depends_on;
+}
+
+ftl::StringView StartupConfigImage::GetDependsOnName(size_t index) const {
+  FTL_DCHECK(index < num_depends_on());
+  return GetString(depends_on()[index].name);
+}
+
+std::vector<std::string> StartupConfigImage::GetDependsOn(size_t index) const {
+  FTL_DCHECK(index < num_depends_on());
+  return GetListItems(depends_on()[index]);
+}
+
+ftl::StringView StartupConfigImage::options() const {
+  return GetString({header()->options_offset, header()->options_length});
+}
+
+uint32_t StartupConfigImage::config_hash() const {
+  return header()->config_hash;
+}
+
+// static
+uint32_t StartupConfigImage::HashConfig(ftl::StringView config) {
+  // FNV-1a, as in compile_startup_config.py.
+  uint32_t hash = kFnvOffsetBasis;
+  for (size_t i = 0; i < config.size(); ++i) {
+    hash ^= static_cast<uint8_t>(config[i]);
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+bool StartupConfigImage::IsValid() const {
+  static_assert(sizeof(Header) == 68,
+                "Header must match compile_startup_config.py");
+  const Header* h = header();
+  if (memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 ||
+      h->version != kVersion || h->size != size_)
+    return false;
+
+  // Each section must be aligned and lie within the image. Offsets and counts
+  // are 32-bit, so these sums cannot overflow 64 bits.
+  auto section_fits = [this](uint64_t offset, uint64_t count, size_t size) {
+    return offset % 4 == 0 && offset + count * size <= size_;
+  };
+  if (!section_fits(h->initial_apps_offset, h->num_initial_apps,
+                    sizeof(StringRef)) ||
+      !section_fits(h->args_for_offset, h->num_args_for, sizeof(ListEntry)) ||
+      !section_fits(h->depends_on_offset, h->num_depends_on,
+                    sizeof(ListEntry)) ||
+      !section_fits(h->list_items_offset, h->num_list_items,
+                    sizeof(StringRef)) ||
+      !section_fits(h->strings_offset, h->strings_size, 1))
+    return false;
+
+  // Checked once here, so that the accessors can trust the image.
+  auto string_fits = [h](const StringRef& ref) {
+    return static_cast<uint64_t>(ref.offset) + ref.length <= h->strings_size;
+  };
+  auto list_fits = [h, &string_fits](const ListEntry& entry) {
+    return string_fits(entry.name) &&
+           static_cast<uint64_t>(entry.first_item) + entry.num_items <=
+               h->num_list_items;
+  };
+  if (!string_fits({h->options_offset, h->options_length}))
+    return false;
+  const StringRef* refs =
+      reinterpret_cast<const StringRef*>(data_ + h->initial_apps_offset);
+  if (!std::all_of(refs, refs + h->num_initial_apps, string_fits))
+    return false;
+  refs = reinterpret_cast<const StringRef*>(data_ + h->list_items_offset);
+  if (!std::all_of(refs, refs + h->num_list_items, string_fits))
+    return false;
+  if (!std::all_of(args_for(), args_for() + h->num_args_for, list_fits) ||
+      !std::all_of(depends_on(), depends_on() + h->num_depends_on, list_fits))
+    return false;
+  return true;
+}
+
+const StartupConfigImage::Header* StartupConfigImage::header() const {
+  return reinterpret_cast<const Header*>(data_);
+}
+
+ftl::StringView StartupConfigImage::GetString(const StringRef& ref) const {
+  return ftl::StringView(reinterpret_cast<const char*>(data_) +
+                             header()->strings_offset + ref.offset,
+                         ref.length);
+}
+
+std::vector<std::string> StartupConfigImage::GetListItems(
+    const ListEntry& entry) const {
+  const StringRef* refs = reinterpret_cast<const StringRef*>(
+      data_ + header()->list_items_offset);
+  std::vector<std::string> items;
+  items.reserve(entry.num_items);
+  for (uint32_t i = 0; i < entry.num_items; ++i)
+    items.push_back(GetString(refs[entry.first_item + i]).ToString());
+  return items;
+}
+
+const StartupConfigImage::ListEntry* StartupConfigImage::args_for() const {
+  return reinterpret_cast<const ListEntry*>(data_ +
+                                            header()->args_for_offset);
+}
+
+const StartupConfigImage::ListEntry* StartupConfigImage::depends_on() const {
+  return reinterpret_cast<const ListEntry*>(data_ +
+                                            header()->depends_on_offset);
+}
+
+}  // namespace mojo
@@ -0,0 +1,98 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_STARTUP_CONFIG_IMAGE_H_
+#define MOJO_APPLICATION_MANAGER_STARTUP_CONFIG_IMAGE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace mojo {
+
+// A startup config compiled ahead of time by compile_startup_config.py. The
+// image is mapped read-only and queried in place, so the initial apps,
+// arguments and dependencies are neither parsed nor copied until they are
+// asked for.
+//
+// The image is little-endian and made of 32-bit words:
+//
+//   header        "MOJOSCFG", the version, the size of the image, then the
+//                 offset and count of each of the following sections, the
+//                 offset and length of |options| within the strings, and the
+//                 hash of the config the image was compiled from
+//   initial apps  string refs, in launch order
+//   args-for      list entries, sorted by name
+//   depends-on    list entries, sorted by name
+//   list items    string refs, indexed by the list entries
+//   strings       UTF-8 bytes, each distinct string stored once
+//
+// A string ref is the offset and length of a string within the strings. A list
+// entry is a string ref to the application's name, followed by the index of
+// its first item and the number of items. |options| holds the rest of the
+// config as JSON, to be read by |StartupConfig::Parse|.
+class StartupConfigImage {
+ public:
+  ~StartupConfigImage();
+
+  // Maps the image at |path|. Returns null if there is no image there, or if
+  // it is not an image of the version this code reads.
+  static std::unique_ptr<StartupConfigImage> Open(const std::string& path);
+
+  std::vector<std::string> GetInitialApps() const;
+
+  // Sets |*args| to the arguments for |name| and returns true, or returns
+  // false if there are none.
+  bool FindArgsFor(ftl::StringView name, std::vector<std::string>* args) const;
+  size_t num_args_for() const;
+  // The name of the |index|th application with arguments.
+  ftl::StringView GetArgsForName(size_t index) const;
+
+  size_t num_depends_on() const;
+  // The name of the |index|th application with dependencies, and the
+  // applications it depends on.
+  ftl::StringView GetDependsOnName(size_t index) const;
+  std::vector<std::string> GetDependsOn(size_t index) const;
+
+  // The rest of the config, as JSON.
+  ftl::StringView options() const;
+
+  // The |HashConfig| of the config this image was compiled from, so that an
+  // image left behind by an earlier version of the config is not used.
+  uint32_t config_hash() const;
+
+  // Hashes the bytes of a config file the way compile_startup_config.py does.
+  static uint32_t HashConfig(ftl::StringView config);
+
+ private:
+  struct Header;
+  struct StringRef;
+  struct ListEntry;
+
+  StartupConfigImage(const uint8_t* data, size_t size, bool mapped);
+
+  bool IsValid() const;
+  const Header* header() const;
+  ftl::StringView GetString(const StringRef& ref) const;
+  std::vector<std::string> GetListItems(const ListEntry& entry) const;
+  const ListEntry* args_for() const;
+  const ListEntry* depends_on() const;
+
+  const uint8_t* const data_;
+  const size_t size_;
+  // Whether |data_| is mapped, rather than read into the heap because the file
+  // could not be mapped.
+  const bool mapped_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(StartupConfigImage);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_STARTUP_CONFIG_IMAGE_H_
@@ -0,0 +1,100 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/startup_scheduler.h"
+
+#include <deque>
+#include <unordered_set>
+#include <utility>
+
+#include "lib/ftl/logging.h"
+
+namespace mojo {
+
+StartupScheduler::StartupScheduler(std::vector<std::string> names,
+                                   const ApplicationDependencies& dependencies,
+                                   LaunchCallback launch)
+    : launch_(std::move(launch)) {
+  for (auto& name : names) {
+    if (nodes_.emplace(name, Node()).second)
+      names_.push_back(std::move(name));
+  }
+  num_remaining_ = names_.size();
+
+  for (const auto& name : names_) {
+    auto it = dependencies.find(name);
+    if (it == dependencies.end())
+      continue;
+    std::unordered_set<std::string> seen;
+    for (const auto& dependency : it->second) {
+      auto dependency_it = nodes_.find(dependency);
+      if (dependency == name || dependency_it == nodes_.end() ||
+          !seen.insert(dependency).second)
+        continue;
+      dependency_it->second.dependents.push_back(name);
+      ++nodes_[name].num_waiting_on;
+    }
+  }
+
+  BreakCycles();
+}
+
+StartupScheduler::~StartupScheduler() = default;
+
+void StartupScheduler::Start() {
+  for (const auto& name : names_) {
+    const Node& node = nodes_[name];
+    if (!node.launched && node.num_waiting_on == 0)
+      Launch(name);
+  }
+}
+
+void StartupScheduler::BreakCycles() {
+  // Walk the graph in launch order; anything that is never reached is in (or
+  // waiting on) a cycle and would otherwise never be launched.
+  std::unordered_map<std::string, size_t> num_waiting_on;
+  std::deque<std::string> ready;
+  for (const auto& name : names_) {
+    num_waiting_on[name] = nodes_[name].num_waiting_on;
+    if (nodes_[name].num_waiting_on == 0)
+      ready.push_back(name);
+  }
+  while (!ready.empty()) {
+    std::string name = std::move(ready.front());
+    ready.pop_front();
+    for (const auto& dependent : nodes_[name].dependents) {
+      if (--num_waiting_on[dependent] == 0)
+        ready.push_back(dependent);
+    }
+  }
+  for (const auto& name : names_) {
+    if (num_waiting_on[name] != 0) {
+      FTL_LOG(WARNING) << "Ignoring cyclic startup dependencies of \"" << name
+                       << "\"";
+      nodes_[name].num_waiting_on = 0;
+    }
+  }
+}
+
+void StartupScheduler::Launch(const std::string& name) {
+  Node& node = nodes_[name];
+  FTL_DCHECK(!node.launched);
+  node.launched = true;
+  launch_(name, [this, name] { OnLaunched(name); });
+}
+
+void StartupScheduler::OnLaunched(const std::string& name) {
+  FTL_DCHECK(num_remaining_ > 0);
+  --num_remaining_;
+  for (const auto& dependent : nodes_[name].dependents) {
+    Node& node = nodes_[dependent];
+    // Nodes whose cyclic dependencies were ignored may already be launched.
+    if (node.launched || node.num_waiting_on == 0)
+      continue;
+    if (--node.num_waiting_on == 0)
+      Launch(dependent);
+  }
+}
+
+}  // namespace mojo
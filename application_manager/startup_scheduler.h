@@ -0,0 +1,64 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_STARTUP_SCHEDULER_H_
+#define MOJO_APPLICATION_MANAGER_STARTUP_SCHEDULER_H_
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+#include "mojo/application_manager/application_manager.h"
+
+namespace mojo {
+
+// Orders the launches of the initial applications. Every application whose
+// dependencies have all been launched is launched at once, so independent
+// applications start concurrently; each completed launch releases the
+// applications that were waiting for it.
+//
+// Dependencies on applications that are not in the list are ignored, as are
+// dependencies that form a cycle (with a warning).
+class StartupScheduler {
+ public:
+  // Called to launch an application. The callee must call |done| on the
+  // message loop once the launch has completed, whether or not it succeeded.
+  using LaunchCallback =
+      std::function<void(const std::string& name, ftl::Closure done)>;
+
+  StartupScheduler(std::vector<std::string> names,
+                   const ApplicationDependencies& dependencies,
+                   LaunchCallback launch);
+  ~StartupScheduler();
+
+  // Launches every application that has no dependencies.
+  void Start();
+
+  bool is_done() const { return num_remaining_ == 0; }
+
+ private:
+  struct Node {
+    size_t num_waiting_on = 0;
+    std::vector<std::string> dependents;
+    bool launched = false;
+  };
+
+  void BreakCycles();
+  void Launch(const std::string& name);
+  void OnLaunched(const std::string& name);
+
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, Node> nodes_;
+  LaunchCallback launch_;
+  size_t num_remaining_ = 0;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(StartupScheduler);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_STARTUP_SCHEDULER_H_
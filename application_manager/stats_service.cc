@@ -0,0 +1,222 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/stats_service.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "mojo/application_manager/application_manager.h"
+#include "mojo/public/cpp/environment/environment.h"
+
+namespace mojo {
+namespace {
+
+// Streams may not ask for snapshots more often than this.
+constexpr ftl::TimeDelta kMinStreamInterval =
+    ftl::TimeDelta::FromMilliseconds(100);
+
+}  // namespace
+
+// static
+std::string StatsService::SnapshotToJson(
+    const application_manager::ApplicationManagerSnapshot& snapshot) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("timestamp_us");
+  writer.Int64(snapshot.timestamp_us);
+  writer.Key("applications");
+  writer.StartArray();
+  for (size_t i = 0; i < snapshot.applications.size(); ++i) {
+    const auto& stats = *snapshot.applications[i];
+    writer.StartObject();
+    writer.Key("name");
+    writer.String(stats.name.get().c_str());
+    writer.Key("running");
+    writer.Bool(stats.running);
+    writer.Key("num_launches");
+    writer.Uint(stats.num_launches);
+    writer.Key("num_launch_failures");
+    writer.Uint(stats.num_launch_failures);
+    writer.Key("num_terminations");
+    writer.Uint(stats.num_terminations);
+    writer.Key("num_requested_quits");
+    writer.Uint(stats.num_requested_quits);
+    writer.Key("num_connections");
+    writer.Uint64(stats.num_connections);
+    writer.Key("num_content_handler_requests");
+    writer.Uint64(stats.num_content_handler_requests);
+    writer.Key("num_content_handler_failures");
+    writer.Uint64(stats.num_content_handler_failures);
+    writer.Key("ready_p50_us");
+    writer.Int64(stats.ready_p50_us);
+    writer.Key("ready_p99_us");
+    writer.Int64(stats.ready_p99_us);
+    writer.Key("memory_bytes");
+    writer.Uint64(stats.memory_bytes);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  std::string json(buffer.GetString(), buffer.GetSize());
+  json.push_back('\n');
+  return json;
+}
+
+StatsService::StatsService(ApplicationManager* manager)
+    : manager_(manager),
+      waiter_(Environment::GetDefaultAsyncWaiter()),
+      weak_factory_(this) {}
+
+StatsService::~StatsService() {
+  for (const auto& entry : streams_) {
+    if (entry.second.wait_id)
+      waiter_->CancelWait(entry.second.wait_id);
+  }
+}
+
+void StatsService::AddBinding(InterfaceRequest<ServiceProvider> services) {
+  service_provider_bindings_.AddBinding(this, std::move(services));
+}
+
+void StatsService::ConnectToService(const String& service_name,
+                                    ScopedMessagePipeHandle client_handle) {
+  if (service_name == application_manager::ApplicationManagerStats::Name_) {
+    stats_bindings_.AddBinding(
+        this, InterfaceRequest<application_manager::ApplicationManagerStats>(
+                  std::move(client_handle)));
+  }
+}
+
+void StatsService::GetSnapshot(const GetSnapshotCallback& callback) {
+  callback.Run(TakeSnapshot());
+}
+
+void StatsService::StreamSnapshots(uint32_t interval_ms,
+                                   ScopedDataPipeProducerHandle stream) {
+  if (!stream.is_valid())
+    return;
+  uint64_t stream_id = next_stream_id_++;
+  Stream& entry = streams_[stream_id];
+  entry.service = this;
+  entry.id = stream_id;
+  entry.producer = std::move(stream);
+  entry.interval = std::max(ftl::TimeDelta::FromMilliseconds(interval_ms),
+                            kMinStreamInterval);
+  WriteToStream(stream_id);
+}
+
+application_manager::ApplicationManagerSnapshotPtr StatsService::TakeSnapshot()
+    const {
+  auto snapshot = application_manager::ApplicationManagerSnapshot::New();
+  snapshot->timestamp_us =
+      (ftl::TimePoint::Now() - ftl::TimePoint()).ToMicroseconds();
+  snapshot->applications =
+      Array<application_manager::ApplicationStatsPtr>::New(0);
+  for (const auto& entry : manager_->counters()) {
+    const std::string& name = manager_->names()->GetName(entry.first);
+    const ApplicationCounters& counters = entry.second;
+    auto stats = application_manager::ApplicationStats::New();
+    stats->name = name;
+    stats->running = manager_->IsRunning(entry.first);
+    stats->num_launches = counters.num_launches;
+    stats->num_launch_failures = counters.num_launch_failures;
+    stats->num_terminations = counters.num_terminations;
+    stats->num_requested_quits = counters.num_requested_quits;
+    stats->num_connections = counters.num_connections;
+    stats->num_content_handler_requests =
+        counters.num_content_handler_requests;
+    stats->num_content_handler_failures =
+        counters.num_content_handler_failures;
+    ftl::TimeDelta p50;
+    ftl::TimeDelta p99;
+    if (manager_->launch_tracer().GetPercentiles(
+            name, LaunchTimeline::Stage::kReady, &p50, &p99)) {
+      stats->ready_p50_us = p50.ToMicroseconds();
+      stats->ready_p99_us = p99.ToMicroseconds();
+    }
+    stats->memory_bytes = manager_->GetMemoryUsage(entry.first);
+    snapshot->applications.push_back(std::move(stats));
+  }
+  return snapshot;
+}
+
+void StatsService::ScheduleStreamWrite(uint64_t stream_id) {
+  auto it = streams_.find(stream_id);
+  FTL_DCHECK(it != streams_.end());
+  ftl::WeakPtr<StatsService> weak_this = weak_factory_.GetWeakPtr();
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this, stream_id] {
+        if (weak_this)
+          weak_this->WriteToStream(stream_id);
+      },
+      it->second.interval);
+}
+
+void StatsService::WaitForStreamWritable(Stream* stream) {
+  FTL_DCHECK(!stream->wait_id);
+  stream->wait_id = waiter_->AsyncWait(
+      stream->producer.get().value(), MOJO_HANDLE_SIGNAL_WRITABLE,
+      MOJO_DEADLINE_INDEFINITE, &StatsService::OnStreamWritable, stream);
+}
+
+// static
+void StatsService::OnStreamWritable(void* closure, MojoResult result) {
+  Stream* stream = static_cast<Stream*>(closure);
+  stream->wait_id = 0;
+  StatsService* service = stream->service;
+  if (result != MOJO_RESULT_OK) {
+    // The consumer has gone away.
+    service->CloseStream(service->streams_.find(stream->id));
+    return;
+  }
+  service->WriteToStream(stream->id);
+}
+
+void StatsService::WriteToStream(uint64_t stream_id) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end())
+    return;
+  Stream& stream = it->second;
+  // A new snapshot is only taken once the last one has been written out, so
+  // that a slow consumer never sees part of a line followed by another line.
+  if (stream.pending_offset == stream.pending.size()) {
+    stream.pending = SnapshotToJson(*TakeSnapshot());
+    stream.pending_offset = 0u;
+  }
+  uint32_t num_bytes =
+      static_cast<uint32_t>(stream.pending.size() - stream.pending_offset);
+  MojoResult result = WriteDataRaw(
+      stream.producer.get(), stream.pending.data() + stream.pending_offset,
+      &num_bytes, MOJO_WRITE_DATA_FLAG_NONE);
+  if (result == MOJO_RESULT_OK) {
+    stream.pending_offset += num_bytes;
+  } else if (result != MOJO_RESULT_SHOULD_WAIT) {
+    // The consumer has gone away.
+    CloseStream(it);
+    return;
+  }
+  // The rest of the snapshot is written as soon as the consumer has made
+  // room for it, and the next one after the stream's interval.
+  if (stream.pending_offset < stream.pending.size())
+    WaitForStreamWritable(&stream);
+  else
+    ScheduleStreamWrite(stream_id);
+}
+
+void StatsService::CloseStream(std::map<uint64_t, Stream>::iterator it) {
+  if (it == streams_.end())
+    return;
+  if (it->second.wait_id)
+    waiter_->CancelWait(it->second.wait_id);
+  streams_.erase(it);
+}
+
+}  // namespace mojo
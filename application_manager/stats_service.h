@@ -0,0 +1,85 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_STATS_SERVICE_H_
+#define MOJO_APPLICATION_MANAGER_STATS_SERVICE_H_
+
+#include <mojo/environment/async_waiter.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_delta.h"
+#include "mojo/public/cpp/bindings/binding_set.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/interfaces/application/service_provider.mojom.h"
+#include "mojo/services/application_manager/interfaces/application_manager_stats.mojom.h"
+
+namespace mojo {
+class ApplicationManager;
+
+// Serves the application manager's own services to the connections made to
+// it by name. For now, that is application_manager.ApplicationManagerStats.
+class StatsService : public ServiceProvider,
+                     public application_manager::ApplicationManagerStats {
+ public:
+  // |manager| must outlive this object.
+  explicit StatsService(ApplicationManager* manager);
+  ~StatsService() override;
+
+  void AddBinding(InterfaceRequest<ServiceProvider> services);
+
+  // |ServiceProvider|:
+  void ConnectToService(const String& service_name,
+                        ScopedMessagePipeHandle client_handle) override;
+
+  // |application_manager::ApplicationManagerStats|:
+  void GetSnapshot(const GetSnapshotCallback& callback) override;
+  void StreamSnapshots(uint32_t interval_ms,
+                       ScopedDataPipeProducerHandle stream) override;
+
+  // Formats |snapshot| as a line of JSON, as it is streamed.
+  static std::string SnapshotToJson(
+      const application_manager::ApplicationManagerSnapshot& snapshot);
+
+ private:
+  struct Stream {
+    StatsService* service = nullptr;
+    uint64_t id = 0u;
+    ScopedDataPipeProducerHandle producer;
+    ftl::TimeDelta interval;
+    // The snapshot being written, and how much of it has been written.
+    std::string pending;
+    size_t pending_offset = 0u;
+    // Set while waiting for the pipe to have room for the rest of |pending|.
+    MojoAsyncWaitID wait_id = 0;
+  };
+
+  static void OnStreamWritable(void* closure, MojoResult result);
+
+  application_manager::ApplicationManagerSnapshotPtr TakeSnapshot() const;
+  void ScheduleStreamWrite(uint64_t stream_id);
+  void WaitForStreamWritable(Stream* stream);
+  void WriteToStream(uint64_t stream_id);
+  void CloseStream(std::map<uint64_t, Stream>::iterator it);
+
+  ApplicationManager* const manager_;
+  BindingSet<ServiceProvider> service_provider_bindings_;
+  BindingSet<application_manager::ApplicationManagerStats> stats_bindings_;
+  const MojoAsyncWaiter* const waiter_;
+  // A map, so that the streams that are waited on do not move.
+  std::map<uint64_t, Stream> streams_;
+  uint64_t next_stream_id_ = 1u;
+
+  ftl::WeakPtrFactory<StatsService> weak_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(StatsService);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_STATS_SERVICE_H_
@@ -0,0 +1,73 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/application_names.h"
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace {
+
+TEST(ApplicationNamesTest, ReplicasShareTheBaseName) {
+  ApplicationNames names;
+  ApplicationId handler = names.Intern("file:///system/apps/handler");
+  ApplicationId replica = names.InternReplica(handler, 2);
+  EXPECT_NE(handler, replica);
+  EXPECT_EQ(handler, names.InternReplica(handler, 0));
+  EXPECT_EQ(replica, names.InternReplica(handler, 2));
+  EXPECT_EQ("mojo:handler?replica=2", names.GetName(replica));
+  EXPECT_EQ("mojo:handler", names.GetBaseName(replica));
+  EXPECT_EQ("mojo:handler", names.GetBaseName(handler));
+}
+
+TEST(ApplicationNamesTest, ReplicasOfInstancePerQueryHandlers) {
+  ApplicationNames names;
+  names.set_instance_per_query({"mojo:handler"});
+  ApplicationId handler = names.Intern("mojo:handler?x=1");
+  ApplicationId replica = names.InternReplica(handler, 1);
+  // The replica's parameter is added to the query rather than starting a
+  // second one.
+  EXPECT_EQ("mojo:handler?x=1&replica=1", names.GetName(replica));
+  EXPECT_EQ("mojo:handler?x=1", names.GetBaseName(replica));
+  // A name given to |Intern| never stands for a replica.
+  EXPECT_NE(replica, names.Intern("mojo:handler?x=1&replica=1"));
+}
+
+TEST(ApplicationNamesTest, OnlyResolvableSchemesAreLaunchable) {
+  EXPECT_TRUE(ApplicationNames::IsLaunchable("mojo:foo"));
+  EXPECT_TRUE(ApplicationNames::IsLaunchable("file:///system/apps/foo"));
+  EXPECT_FALSE(ApplicationNames::IsLaunchable("https://example.com/foo"));
+  EXPECT_FALSE(ApplicationNames::IsLaunchable("foo"));
+}
+
+TEST(ApplicationNamesTest, ReleasedIdsAreReused) {
+  ApplicationNames names;
+  EXPECT_EQ(kInvalidApplicationId, names.Find("mojo:foo"));
+  ApplicationId foo = names.Intern("mojo:foo?x=1");
+  EXPECT_EQ(foo, names.Find("file:///system/apps/foo"));
+
+  names.Release(foo);
+  // Neither the canonical name nor the name as it was given finds it.
+  EXPECT_EQ(kInvalidApplicationId, names.Find("mojo:foo"));
+  EXPECT_EQ(kInvalidApplicationId, names.Find("mojo:foo?x=1"));
+
+  ApplicationId bar = names.Intern("mojo:bar");
+  EXPECT_EQ(foo, bar);
+  EXPECT_EQ("mojo:bar", names.GetName(bar));
+  EXPECT_NE(bar, names.Intern("mojo:foo"));
+}
+
+TEST(ApplicationNamesTest, InstancesPerQuery) {
+  ApplicationNames names;
+  names.set_instance_per_query({"mojo:handler"});
+  ApplicationId handler = names.Intern("mojo:handler");
+  ApplicationId instance = names.Intern("mojo:handler?x=1");
+  EXPECT_FALSE(names.IsInstancePerQuery(handler));
+  EXPECT_TRUE(names.IsInstancePerQuery(instance));
+  EXPECT_FALSE(names.IsInstancePerQuery(names.InternReplica(handler, 1)));
+  EXPECT_FALSE(names.IsInstancePerQuery(names.Intern("mojo:other?x=1")));
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,110 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/application_reaper.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace {
+
+using Candidate = ApplicationReaper::Candidate;
+
+Candidate MakeCandidate(ApplicationId id,
+                        std::string base_name,
+                        ftl::TimePoint last_activity,
+                        uint64_t memory_usage = 0u) {
+  Candidate candidate;
+  candidate.id = id;
+  candidate.base_name = std::move(base_name);
+  candidate.last_activity = last_activity;
+  candidate.memory_usage = memory_usage;
+  return candidate;
+}
+
+TEST(ApplicationReaperTest, SelectsApplicationsIdleForTheirTimeout) {
+  const ftl::TimePoint now = ftl::TimePoint::Now();
+  ReapingPolicy policy;
+  policy.default_idle_timeout = ftl::TimeDelta::FromSeconds(60);
+  policy.idle_timeouts["mojo:patient"] = ftl::TimeDelta::FromSeconds(600);
+  policy.idle_timeouts["mojo:forever"] = ftl::TimeDelta::Zero();
+  policy.keep_alive.insert("mojo:kept");
+
+  const ftl::TimePoint long_ago = now - ftl::TimeDelta::FromSeconds(120);
+  std::vector<Candidate> candidates = {
+      MakeCandidate(1, "mojo:idle", long_ago),
+      MakeCandidate(2, "mojo:recent", now - ftl::TimeDelta::FromSeconds(30)),
+      MakeCandidate(3, "mojo:patient", long_ago),
+      MakeCandidate(4, "mojo:forever", long_ago),
+      MakeCandidate(5, "mojo:kept", long_ago),
+      MakeCandidate(6, "mojo:handler", long_ago),
+  };
+  candidates[5].is_busy_content_handler = true;
+  EXPECT_EQ(std::vector<ApplicationId>({1}),
+            ApplicationReaper::SelectIdle(policy, candidates, now));
+
+  // Without a default timeout, only applications with their own are reaped.
+  policy.default_idle_timeout = ftl::TimeDelta::Zero();
+  EXPECT_TRUE(ApplicationReaper::SelectIdle(policy, candidates, now).empty());
+  EXPECT_EQ(std::vector<ApplicationId>({3}),
+            ApplicationReaper::SelectIdle(
+                policy, candidates, now + ftl::TimeDelta::FromSeconds(600)));
+}
+
+TEST(ApplicationReaperTest, SelectsLeastRecentlyUsedUntilWithinBudget) {
+  const ftl::TimePoint now = ftl::TimePoint::Now();
+  ReapingPolicy policy;
+  policy.memory_budget = 100;
+  auto ago = [now](int64_t seconds) {
+    return now - ftl::TimeDelta::FromSeconds(seconds);
+  };
+  std::vector<Candidate> candidates = {
+      MakeCandidate(1, "mojo:newest", ago(1), 40),
+      MakeCandidate(2, "mojo:oldest", ago(50), 30),
+      MakeCandidate(3, "mojo:middle", ago(20), 30),
+      MakeCandidate(4, "mojo:older", ago(30), 30),
+  };
+
+  // Within the budget, nothing quits.
+  EXPECT_TRUE(
+      ApplicationReaper::SelectOverBudget(policy, candidates, 100).empty());
+  // 130 bytes in use: quitting the least recently used application is enough.
+  EXPECT_EQ(std::vector<ApplicationId>({2}),
+            ApplicationReaper::SelectOverBudget(policy, candidates, 130));
+  // Memory that no candidate accounts for, such as that of applications
+  // still starting, can push the newest out too.
+  EXPECT_EQ(std::vector<ApplicationId>({2, 4, 3, 1}),
+            ApplicationReaper::SelectOverBudget(policy, candidates, 200));
+}
+
+TEST(ApplicationReaperTest, BudgetSparesKeptBusyAndUnmeasuredApplications) {
+  const ftl::TimePoint now = ftl::TimePoint::Now();
+  ReapingPolicy policy;
+  policy.memory_budget = 50;
+  policy.keep_alive.insert("mojo:kept");
+  auto ago = [now](int64_t seconds) {
+    return now - ftl::TimeDelta::FromSeconds(seconds);
+  };
+  std::vector<Candidate> candidates = {
+      MakeCandidate(1, "mojo:kept", ago(40), 30),
+      MakeCandidate(2, "mojo:handler", ago(30), 30),
+      MakeCandidate(3, "mojo:unmeasured", ago(20)),
+      MakeCandidate(4, "mojo:other", ago(10), 30),
+  };
+  candidates[1].is_busy_content_handler = true;
+  EXPECT_EQ(std::vector<ApplicationId>({4}),
+            ApplicationReaper::SelectOverBudget(policy, candidates, 90));
+
+  // Without a budget, nothing is over it.
+  policy.memory_budget = 0;
+  EXPECT_TRUE(
+      ApplicationReaper::SelectOverBudget(policy, candidates, 90).empty());
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,160 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/connection_profile.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace mojo {
+
+// Drives the profile directly rather than through its timers and the I/O
+// pool, which the tests never run.
+class ConnectionProfileTest : public testing::Test {
+ protected:
+  using EntryMap = ConnectionProfile::EntryMap;
+
+  ConnectionProfileTest() : profile_("/nonexistent", nullptr) {}
+
+  static bool ReadEntries(const std::string& path, EntryMap* entries) {
+    return ConnectionProfile::ReadEntries(path, entries);
+  }
+
+  // Parses |json| as a saved profile.
+  static bool Parse(const std::string& json, EntryMap* entries) {
+    char path[] = "/tmp/connection_profile_unittest.XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    EXPECT_TRUE(files::WriteFile(path, json.data(), json.size()));
+    bool result = ReadEntries(path, entries);
+    unlink(path);
+    return result;
+  }
+
+  void FinishLoad(EntryMap entries = EntryMap()) {
+    profile_.FinishLoad(std::move(entries));
+  }
+
+  // Records a launch of |name| that connected to |targets|.
+  void RecordLaunch(const std::string& name,
+                    const std::vector<std::string>& targets) {
+    profile_.OnLaunched(name);
+    for (const auto& target : targets)
+      profile_.OnConnection(name, target);
+    profile_.FinishRecording(name);
+  }
+
+  uint32_t num_launches(const std::string& name) {
+    return profile_.entries_[name].num_launches;
+  }
+
+  uint32_t num_connections(const std::string& name,
+                           const std::string& target) {
+    auto& connections = profile_.entries_[name].num_connections;
+    auto it = connections.find(target);
+    return it == connections.end() ? 0 : it->second;
+  }
+
+  size_t num_targets(const std::string& name) {
+    return profile_.entries_[name].num_connections.size();
+  }
+
+  // Launches and saves post delayed tasks to the current message loop.
+  mtl::MessageLoop message_loop_;
+  ConnectionProfile profile_;
+};
+
+namespace {
+
+TEST_F(ConnectionProfileTest, ParsesSavedProfile) {
+  EntryMap entries;
+  ASSERT_TRUE(Parse(
+      "{\"mojo:a\": {\"launches\": 3, \"connects-to\": {\"mojo:b\": 2}},"
+      " \"mojo:c\": {\"launches\": 1, \"connects-to\": {}}}",
+      &entries));
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_EQ(3u, entries["mojo:a"].num_launches);
+  EXPECT_EQ(2u, entries["mojo:a"].num_connections["mojo:b"]);
+  EXPECT_EQ(1u, entries["mojo:c"].num_launches);
+  EXPECT_TRUE(entries["mojo:c"].num_connections.empty());
+
+  // A missing profile is an empty one, not an error.
+  EntryMap missing;
+  EXPECT_TRUE(ReadEntries("/nonexistent", &missing));
+  EXPECT_TRUE(missing.empty());
+}
+
+TEST_F(ConnectionProfileTest, RejectsMalformedProfiles) {
+  const char* const malformed[] = {
+      "",
+      "[]",
+      "{\"mojo:a\": 3}",
+      "{\"mojo:a\": {\"connects-to\": {}}}",
+      "{\"mojo:a\": {\"launches\": -1, \"connects-to\": {}}}",
+      "{\"mojo:a\": {\"launches\": 1, \"connects-to\": []}}",
+      "{\"mojo:a\": {\"launches\": 1, \"connects-to\": {\"mojo:b\": \"1\"}}}",
+  };
+  for (const char* json : malformed) {
+    EntryMap entries;
+    EXPECT_FALSE(Parse(json, &entries)) << json;
+  }
+}
+
+TEST_F(ConnectionProfileTest, HalvesCountsToForgetOldHabits) {
+  FinishLoad();
+  RecordLaunch("a", {"b", "c"});
+  for (int i = 0; i < 14; ++i)
+    RecordLaunch("a", {"b"});
+  EXPECT_EQ(15u, num_launches("a"));
+  EXPECT_EQ(15u, num_connections("a", "b"));
+  EXPECT_EQ(1u, num_connections("a", "c"));
+
+  // The sixteenth launch halves everything, and drops what falls to zero.
+  RecordLaunch("a", {"b"});
+  EXPECT_EQ(8u, num_launches("a"));
+  EXPECT_EQ(8u, num_connections("a", "b"));
+  EXPECT_EQ(1u, num_targets("a"));
+}
+
+TEST_F(ConnectionProfileTest, PredictsOnlyHabitualConnections) {
+  // Nothing is predicted before the profile has been read.
+  RecordLaunch("a", {"b"});
+  RecordLaunch("a", {"b"});
+  EXPECT_TRUE(profile_.GetLikelyConnections("a").empty());
+
+  FinishLoad();
+  // Launches recorded while the profile was being read are kept, and two
+  // are enough to be trusted.
+  EXPECT_EQ(std::vector<std::string>({"b"}),
+            profile_.GetLikelyConnections("a"));
+
+  // One launch is not.
+  RecordLaunch("x", {"y"});
+  EXPECT_TRUE(profile_.GetLikelyConnections("x").empty());
+  EXPECT_TRUE(profile_.GetLikelyConnections("unknown").empty());
+}
+
+TEST_F(ConnectionProfileTest, PredictsConnectionsMadeOnHalfOfLaunches) {
+  FinishLoad();
+  RecordLaunch("a", {"b", "c", "d", "e", "f", "g"});
+  RecordLaunch("a", {"b", "c", "d", "e", "f"});
+  RecordLaunch("a", {"b", "f"});
+  RecordLaunch("a", {"b"});
+  // Most often first, then by name; "g" was made on only one launch in four,
+  // and at most four are returned.
+  EXPECT_EQ(std::vector<std::string>({"b", "f", "c", "d"}),
+            profile_.GetLikelyConnections("a"));
+}
+
+}  // namespace
+}  // namespace mojo
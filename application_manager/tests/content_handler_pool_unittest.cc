@@ -0,0 +1,140 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/content_handler_pool.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace mojo {
+namespace {
+
+class ContentHandlerPoolTest : public testing::Test {
+ protected:
+  // With a |max_load| of 1, every application goes to a replica of its own
+  // while there are replicas to spare.
+  std::unique_ptr<ContentHandlerPool> CreatePool(size_t max_instances,
+                                                 size_t max_load = 1) {
+    ContentHandlerPool::Options options;
+    options.max_instances = max_instances;
+    options.max_load = max_load;
+    return std::make_unique<ContentHandlerPool>(
+        options, [this](size_t replica) { stopped_.push_back(replica); });
+  }
+
+  // Releasing a lease may schedule a check on the current message loop.
+  mtl::MessageLoop message_loop_;
+  std::vector<size_t> stopped_;
+};
+
+TEST_F(ContentHandlerPoolTest, ShrinkingStopsIdleReplicasRightAway) {
+  auto pool = CreatePool(2);
+  auto lease0 = pool->Dispatch("a");
+  auto lease1 = pool->Dispatch("b");
+  EXPECT_EQ(0u, lease0->replica());
+  EXPECT_EQ(1u, lease1->replica());
+  lease1.reset();
+  EXPECT_TRUE(stopped_.empty());
+
+  ContentHandlerPool::Options options;
+  options.max_instances = 1;
+  pool->SetOptions(options);
+  EXPECT_EQ(std::vector<size_t>({1u}), stopped_);
+  EXPECT_EQ(1u, pool->num_active_replicas());
+}
+
+TEST_F(ContentHandlerPoolTest, ShrinkingDrainsBusyReplicas) {
+  auto pool = CreatePool(3);
+  auto lease0 = pool->Dispatch("a");
+  auto lease1 = pool->Dispatch("b");
+  auto lease2 = pool->Dispatch("c");
+  EXPECT_EQ(2u, lease2->replica());
+
+  pool->SetOptions(ContentHandlerPool::Options());
+  EXPECT_TRUE(stopped_.empty());
+  // Nothing more goes to the replicas that are left over...
+  EXPECT_EQ(0u, pool->Dispatch("d")->replica());
+  // ...and they are stopped as soon as they are done.
+  lease2.reset();
+  lease1.reset();
+  EXPECT_EQ(std::vector<size_t>({2u, 1u}), stopped_);
+  EXPECT_EQ(1u, pool->num_active_replicas());
+}
+
+TEST_F(ContentHandlerPoolTest, GrowsOnlyWhenLeastLoadedIsFull) {
+  auto pool = CreatePool(3, 2);
+  auto lease_a = pool->Dispatch("a");
+  auto lease_b = pool->Dispatch("b");
+  EXPECT_EQ(0u, lease_a->replica());
+  EXPECT_EQ(0u, lease_b->replica());
+  EXPECT_EQ(1u, pool->num_active_replicas());
+
+  // Replica 0 is full, so another replica is started...
+  auto lease_c = pool->Dispatch("c");
+  EXPECT_EQ(1u, lease_c->replica());
+  EXPECT_EQ(2u, pool->num_active_replicas());
+  // ...and is preferred while it is the least loaded.
+  auto lease_d = pool->Dispatch("d");
+  EXPECT_EQ(1u, lease_d->replica());
+
+  // Once a running replica has room again, it is used rather than another
+  // replica being started.
+  lease_a.reset();
+  auto lease_e = pool->Dispatch("e");
+  EXPECT_EQ(0u, lease_e->replica());
+  EXPECT_EQ(2u, pool->num_active_replicas());
+}
+
+TEST_F(ContentHandlerPoolTest, LeastLoadedSharesOnceAllReplicasAreFull) {
+  auto pool = CreatePool(2, 1);
+  auto lease_a = pool->Dispatch("a");
+  auto lease_b = pool->Dispatch("b");
+  EXPECT_EQ(0u, lease_a->replica());
+  EXPECT_EQ(1u, lease_b->replica());
+
+  // Every replica is running and full, so the least loaded one gets more.
+  auto lease_c = pool->Dispatch("c");
+  EXPECT_EQ(0u, lease_c->replica());
+  auto lease_d = pool->Dispatch("d");
+  EXPECT_EQ(1u, lease_d->replica());
+  lease_b.reset();
+  EXPECT_EQ(1u, pool->Dispatch("e")->replica());
+}
+
+TEST(JumpConsistentHashTest, StaysInRange) {
+  for (uint64_t key = 0; key < 1000; ++key) {
+    EXPECT_EQ(0u, ContentHandlerPool::JumpConsistentHash(key, 1));
+    EXPECT_LT(ContentHandlerPool::JumpConsistentHash(key, 7), 7u);
+  }
+}
+
+TEST(JumpConsistentHashTest, GrowingMovesKeysOnlyToTheNewBucket) {
+  for (size_t num_buckets = 1; num_buckets < 16; ++num_buckets) {
+    for (uint64_t key = 0; key < 1000; ++key) {
+      size_t before = ContentHandlerPool::JumpConsistentHash(key, num_buckets);
+      size_t after =
+          ContentHandlerPool::JumpConsistentHash(key, num_buckets + 1);
+      if (after != before)
+        EXPECT_EQ(num_buckets, after);
+    }
+  }
+}
+
+TEST(JumpConsistentHashTest, SpreadsKeysEvenly) {
+  constexpr size_t kNumBuckets = 4;
+  constexpr uint64_t kNumKeys = 4000;
+  std::vector<size_t> counts(kNumBuckets);
+  for (uint64_t key = 0; key < kNumKeys; ++key)
+    ++counts[ContentHandlerPool::JumpConsistentHash(key, kNumBuckets)];
+  for (size_t count : counts) {
+    EXPECT_GT(count, kNumKeys / kNumBuckets / 2);
+    EXPECT_LT(count, kNumKeys / kNumBuckets * 3 / 2);
+  }
+}
+
+}  // namespace
+}  // namespace mojo
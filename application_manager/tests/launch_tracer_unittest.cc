@@ -0,0 +1,74 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/launch_tracer.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace {
+
+// Records launches of |name| that became ready after |first_ms|, and one more
+// millisecond for each launch after that, up to |last_ms|.
+void RecordLaunches(LaunchTracer* tracer,
+                    const std::string& name,
+                    int first_ms,
+                    int last_ms) {
+  const ftl::TimePoint start = ftl::TimePoint::Now();
+  for (int ms = first_ms; ms <= last_ms; ++ms) {
+    LaunchTimeline timeline;
+    timeline.Mark(LaunchTimeline::Stage::kStarted, start);
+    timeline.Mark(LaunchTimeline::Stage::kReady,
+                  start + ftl::TimeDelta::FromMilliseconds(ms));
+    tracer->RecordLaunch(name, timeline);
+  }
+}
+
+TEST(LaunchTracerTest, ReportsNearestRankPercentiles) {
+  LaunchTracer tracer;
+  ftl::TimeDelta p50;
+  ftl::TimeDelta p99;
+
+  RecordLaunches(&tracer, "mojo:one", 7, 7);
+  ASSERT_TRUE(tracer.GetPercentiles("mojo:one", LaunchTimeline::Stage::kReady,
+                                    &p50, &p99));
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(7), p50);
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(7), p99);
+
+  // With ten samples, the median is the fifth and the 99th percentile the
+  // tenth.
+  RecordLaunches(&tracer, "mojo:ten", 1, 10);
+  ASSERT_TRUE(tracer.GetPercentiles("mojo:ten", LaunchTimeline::Stage::kReady,
+                                    &p50, &p99));
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(5), p50);
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(10), p99);
+
+  RecordLaunches(&tracer, "mojo:hundred", 1, 100);
+  ASSERT_TRUE(tracer.GetPercentiles(
+      "mojo:hundred", LaunchTimeline::Stage::kReady, &p50, &p99));
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(50), p50);
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(99), p99);
+}
+
+TEST(LaunchTracerTest, KeepsOnlyRecentLaunches) {
+  LaunchTracer tracer;
+  ftl::TimeDelta p50;
+  ftl::TimeDelta p99;
+  // Only the last hundred, 51 to 150 ms, are kept.
+  RecordLaunches(&tracer, "mojo:app", 1, 150);
+  ASSERT_TRUE(tracer.GetPercentiles("mojo:app", LaunchTimeline::Stage::kReady,
+                                    &p50, &p99));
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(100), p50);
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(149), p99);
+
+  EXPECT_FALSE(tracer.GetPercentiles(
+      "mojo:app", LaunchTimeline::Stage::kFirstConnection, &p50, &p99));
+  EXPECT_FALSE(tracer.GetPercentiles(
+      "mojo:other", LaunchTimeline::Stage::kReady, &p50, &p99));
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,79 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/resolved_application_cache.h"
+
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace {
+
+constexpr char kPath[] = "/system/apps/app";
+
+struct stat MakeInfo(ino_t inode, off_t size, time_t seconds, long nanos) {
+  struct stat info;
+  memset(&info, 0, sizeof(info));
+  info.st_dev = 1;
+  info.st_ino = inode;
+  info.st_size = size;
+  info.st_mtim.tv_sec = seconds;
+  info.st_mtim.tv_nsec = nanos;
+  return info;
+}
+
+TEST(ResolvedApplicationCacheTest, RemembersUnchangedFiles) {
+  ResolvedApplicationCache cache;
+  struct stat info = MakeInfo(7, 100, 1000, 5);
+  std::string handler = "unset";
+  EXPECT_FALSE(cache.Lookup(kPath, info, &handler));
+
+  cache.Store(kPath, ResolvedApplication(info, "mojo:dart_content_handler"));
+  EXPECT_TRUE(cache.Lookup(kPath, info, &handler));
+  EXPECT_EQ("mojo:dart_content_handler", handler);
+
+  // A native executable is remembered as having no content handler.
+  cache.Store(kPath, ResolvedApplication(info, std::string()));
+  EXPECT_TRUE(cache.Lookup(kPath, info, &handler));
+  EXPECT_EQ("", handler);
+}
+
+TEST(ResolvedApplicationCacheTest, DropsChangedFiles) {
+  struct stat info = MakeInfo(7, 100, 1000, 5);
+  const struct stat changed[] = {
+      MakeInfo(8, 100, 1000, 5),  // Replaced by another file.
+      MakeInfo(7, 101, 1000, 5),  // Grown.
+      MakeInfo(7, 100, 1001, 5),  // Rewritten a second later.
+      MakeInfo(7, 100, 1000, 6),  // Rewritten within the same second.
+  };
+  for (const auto& other : changed) {
+    ResolvedApplicationCache cache;
+    cache.Store(kPath, ResolvedApplication(info, std::string()));
+    std::string handler;
+    EXPECT_FALSE(cache.Lookup(kPath, other, &handler));
+    // The stale entry is gone, so the old file does not match it either.
+    EXPECT_FALSE(cache.Lookup(kPath, info, &handler));
+    EXPECT_EQ(0u, cache.size());
+  }
+}
+
+TEST(ResolvedApplicationCacheTest, EraseAndBound) {
+  ResolvedApplicationCache cache;
+  struct stat info = MakeInfo(7, 100, 1000, 5);
+  cache.Store(kPath, ResolvedApplication(info, std::string()));
+  cache.Erase(kPath);
+  std::string handler;
+  EXPECT_FALSE(cache.Lookup(kPath, info, &handler));
+
+  for (int i = 0; i < 10000; ++i) {
+    cache.Store("/system/apps/app" + std::to_string(i),
+                ResolvedApplication(info, std::string()));
+  }
+  EXPECT_GT(cache.size(), 0u);
+  EXPECT_LT(cache.size(), 10000u);
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,121 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/startup_config_image.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+
+namespace mojo {
+namespace {
+
+// Indices of the header's words; see compile_startup_config.py.
+constexpr size_t kVersionWord = 2;
+constexpr size_t kInitialAppsOffsetWord = 4;
+constexpr size_t kNumInitialAppsWord = 5;
+constexpr size_t kOptionsLengthWord = 15;
+constexpr size_t kHeaderWords = 17;
+
+constexpr uint32_t kConfigHash = 0x12345678u;
+
+// An image with one initial app, "mojo:foo", and options "{}".
+std::vector<uint32_t> MakeImageWords() {
+  constexpr uint32_t kRefOffset = kHeaderWords * 4;
+  constexpr uint32_t kStringsOffset = kRefOffset + 8;
+  std::vector<uint32_t> words = {
+      0, 0,  // Magic, filled in below.
+      2,     // Version.
+      kStringsOffset + 10,
+      kRefOffset, 1,       // Initial apps.
+      kStringsOffset, 0,   // Args-for.
+      kStringsOffset, 0,   // Depends-on.
+      kStringsOffset, 0,   // List items.
+      kStringsOffset, 10,  // Strings.
+      8, 2,                // Options.
+      kConfigHash,
+      0, 8,  // The initial app's string ref.
+  };
+  memcpy(words.data(), "MOJOSCFG", 8);
+  return words;
+}
+
+std::string ToBytes(const std::vector<uint32_t>& words) {
+  std::string bytes(reinterpret_cast<const char*>(words.data()),
+                    words.size() * sizeof(uint32_t));
+  return bytes + "mojo:foo{}";
+}
+
+class StartupConfigImageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char path[] = "/tmp/startup_config_image_unittest.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    path_ = path;
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+  std::unique_ptr<StartupConfigImage> Open(const std::string& bytes) {
+    EXPECT_TRUE(files::WriteFile(path_, bytes.data(), bytes.size()));
+    return StartupConfigImage::Open(path_);
+  }
+
+  std::string path_;
+};
+
+TEST_F(StartupConfigImageTest, OpensValidImage) {
+  std::unique_ptr<StartupConfigImage> image = Open(ToBytes(MakeImageWords()));
+  ASSERT_TRUE(image);
+  EXPECT_EQ(std::vector<std::string>{"mojo:foo"}, image->GetInitialApps());
+  EXPECT_EQ("{}", image->options().ToString());
+  EXPECT_EQ(0u, image->num_args_for());
+  EXPECT_EQ(kConfigHash, image->config_hash());
+}
+
+TEST_F(StartupConfigImageTest, RejectsTruncatedImages) {
+  std::string bytes = ToBytes(MakeImageWords());
+  EXPECT_FALSE(Open(bytes.substr(0, bytes.size() - 1)));
+  EXPECT_FALSE(Open(bytes.substr(0, kHeaderWords * 4 - 1)));
+  EXPECT_FALSE(Open(std::string()));
+}
+
+TEST_F(StartupConfigImageTest, RejectsBadMagicAndVersion) {
+  std::vector<uint32_t> words = MakeImageWords();
+  memcpy(words.data(), "MOJOSCFX", 8);
+  EXPECT_FALSE(Open(ToBytes(words)));
+
+  words = MakeImageWords();
+  words[kVersionWord] = 1;
+  EXPECT_FALSE(Open(ToBytes(words)));
+}
+
+TEST_F(StartupConfigImageTest, RejectsBadOffsets) {
+  // A section that runs past the end of the image.
+  std::vector<uint32_t> words = MakeImageWords();
+  words[kNumInitialAppsWord] = 3;
+  EXPECT_FALSE(Open(ToBytes(words)));
+
+  // A misaligned section.
+  words = MakeImageWords();
+  words[kInitialAppsOffsetWord] += 2;
+  EXPECT_FALSE(Open(ToBytes(words)));
+
+  // A string ref that runs past the end of the strings.
+  words = MakeImageWords();
+  words[kOptionsLengthWord] = 3;
+  EXPECT_FALSE(Open(ToBytes(words)));
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,57 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/startup_config.h"
+
+#include "gtest/gtest.h"
+#include "mojo/application_manager/startup_config_image.h"
+
+namespace mojo {
+namespace {
+
+TEST(StartupConfigTest, ParsesIdleTimeouts) {
+  StartupConfig config;
+  ASSERT_TRUE(config.Parse(
+      "{\"idle-timeout\": 1.5, \"idle-timeout-for\": {\"mojo:foo\": 30}}"));
+  ReapingPolicy policy = config.TakeReapingPolicy();
+  EXPECT_EQ(ftl::TimeDelta::FromMilliseconds(1500),
+            policy.default_idle_timeout);
+  EXPECT_EQ(ftl::TimeDelta::FromSeconds(30), policy.GetIdleTimeout("mojo:foo"));
+}
+
+TEST(StartupConfigTest, RejectsOutOfRangeIdleTimeouts) {
+  StartupConfig negative_config;
+  EXPECT_FALSE(negative_config.Parse("{\"idle-timeout\": -1}"));
+  StartupConfig huge_config;
+  EXPECT_FALSE(huge_config.Parse("{\"idle-timeout\": 1e300}"));
+  StartupConfig huge_for_config;
+  EXPECT_FALSE(huge_for_config.Parse(
+      "{\"idle-timeout-for\": {\"mojo:foo\": 1e300}}"));
+}
+
+TEST(StartupConfigTest, ParsesMemoryBudget) {
+  StartupConfig config;
+  ASSERT_TRUE(config.Parse("{\"memory-budget-mb\": 256}"));
+  EXPECT_EQ(256u * 1024 * 1024, config.TakeReapingPolicy().memory_budget);
+}
+
+TEST(StartupConfigTest, RejectsMemoryBudgetsThatOverflow) {
+  // 2^44 megabytes is 2^64 bytes, one more than fits.
+  StartupConfig overflowing_config;
+  EXPECT_FALSE(
+      overflowing_config.Parse("{\"memory-budget-mb\": 17592186044416}"));
+  StartupConfig largest_config;
+  EXPECT_TRUE(largest_config.Parse("{\"memory-budget-mb\": 17592186044415}"));
+}
+
+// compile_startup_config.py records the same hash in the images it writes.
+TEST(StartupConfigTest, HashesConfigWithFnv1a) {
+  EXPECT_EQ(0x811c9dc5u, StartupConfigImage::HashConfig(""));
+  EXPECT_EQ(0xe40c292cu, StartupConfigImage::HashConfig("a"));
+  EXPECT_NE(StartupConfigImage::HashConfig("{\"initial-apps\": []}"),
+            StartupConfigImage::HashConfig("{\"initial-apps\": [] }"));
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,95 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/startup_scheduler.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace {
+
+class StartupSchedulerTest : public testing::Test {
+ protected:
+  std::unique_ptr<StartupScheduler> CreateScheduler(
+      std::vector<std::string> names,
+      const ApplicationDependencies& dependencies) {
+    return std::make_unique<StartupScheduler>(
+        std::move(names), dependencies,
+        [this](const std::string& name, ftl::Closure done) {
+          launched_.push_back(name);
+          done_[name] = std::move(done);
+        });
+  }
+
+  // Completes the launch of |name|, as the launch pool would.
+  void FinishLaunch(const std::string& name) {
+    ASSERT_TRUE(done_.count(name)) << name;
+    ftl::Closure done = std::move(done_[name]);
+    done_.erase(name);
+    done();
+  }
+
+  std::vector<std::string> launched_;
+  std::map<std::string, ftl::Closure> done_;
+};
+
+TEST_F(StartupSchedulerTest, LaunchesIndependentApplicationsAtOnce) {
+  auto scheduler = CreateScheduler({"a", "b", "a", "c"}, {});
+  scheduler->Start();
+  // Duplicates are launched once.
+  EXPECT_EQ(std::vector<std::string>({"a", "b", "c"}), launched_);
+  EXPECT_FALSE(scheduler->is_done());
+  FinishLaunch("a");
+  FinishLaunch("b");
+  FinishLaunch("c");
+  EXPECT_TRUE(scheduler->is_done());
+}
+
+TEST_F(StartupSchedulerTest, WaitsForDependencies) {
+  // "d" depends on an application that is not in the list, and on itself,
+  // neither of which holds it back.
+  auto scheduler = CreateScheduler(
+      {"c", "b", "a", "d"},
+      {{"c", {"a", "b"}}, {"b", {"a", "a"}}, {"d", {"x", "d"}}});
+  scheduler->Start();
+  EXPECT_EQ(std::vector<std::string>({"a", "d"}), launched_);
+
+  FinishLaunch("a");
+  EXPECT_EQ(std::vector<std::string>({"a", "d", "b"}), launched_);
+  FinishLaunch("d");
+  FinishLaunch("b");
+  EXPECT_EQ(std::vector<std::string>({"a", "d", "b", "c"}), launched_);
+  EXPECT_FALSE(scheduler->is_done());
+  FinishLaunch("c");
+  EXPECT_TRUE(scheduler->is_done());
+}
+
+TEST_F(StartupSchedulerTest, IgnoresCycles) {
+  // "a" and "b" depend on each other, and "c" waits on the cycle, so all
+  // three are launched without waiting. "e" still waits for "d".
+  auto scheduler =
+      CreateScheduler({"a", "b", "c", "d", "e"},
+                      {{"a", {"b"}}, {"b", {"a"}}, {"c", {"a"}}, {"e", {"d"}}});
+  scheduler->Start();
+  EXPECT_EQ(std::vector<std::string>({"a", "b", "c", "d"}), launched_);
+
+  // Finishing a launch does not launch the members of the cycle again.
+  FinishLaunch("a");
+  FinishLaunch("b");
+  FinishLaunch("c");
+  EXPECT_EQ(4u, launched_.size());
+  FinishLaunch("d");
+  EXPECT_EQ("e", launched_.back());
+  FinishLaunch("e");
+  EXPECT_TRUE(scheduler->is_done());
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,103 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/stats_service.h"
+
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "mojo/application_manager/application_manager.h"
+
+namespace mojo {
+namespace {
+
+TEST(StatsServiceTest, FormatsSnapshotsAsOneLineOfJson) {
+  auto snapshot = application_manager::ApplicationManagerSnapshot::New();
+  snapshot->timestamp_us = 42;
+  snapshot->applications =
+      Array<application_manager::ApplicationStatsPtr>::New(0);
+  auto stats = application_manager::ApplicationStats::New();
+  stats->name = "mojo:\"quoted\"";
+  stats->running = true;
+  stats->num_launches = 3;
+  stats->num_launch_failures = 1;
+  stats->num_terminations = 2;
+  stats->num_requested_quits = 0;
+  stats->num_connections = 7;
+  stats->num_content_handler_requests = 5;
+  stats->num_content_handler_failures = 4;
+  stats->ready_p50_us = 1000;
+  stats->ready_p99_us = 9000;
+  stats->memory_bytes = 4096;
+  snapshot->applications.push_back(std::move(stats));
+
+  EXPECT_EQ(
+      "{\"timestamp_us\":42,\"applications\":["
+      "{\"name\":\"mojo:\\\"quoted\\\"\",\"running\":true,"
+      "\"num_launches\":3,\"num_launch_failures\":1,\"num_terminations\":2,"
+      "\"num_requested_quits\":0,\"num_connections\":7,"
+      "\"num_content_handler_requests\":5,"
+      "\"num_content_handler_failures\":4,\"ready_p50_us\":1000,"
+      "\"ready_p99_us\":9000,\"memory_bytes\":4096}]}\n",
+      StatsService::SnapshotToJson(*snapshot));
+}
+
+class StatsServiceStreamTest : public testing::Test {
+ protected:
+  StatsServiceStreamTest()
+      : manager_(ApplicationArgs(), std::unordered_set<std::string>()),
+        service_(&manager_) {}
+
+  // Reads what is in the pipe now, running the message loop for a while
+  // first so that the service can write more.
+  std::string ReadAvailable(const ScopedDataPipeConsumerHandle& consumer) {
+    message_loop_.task_runner()->PostDelayedTask(
+        [this] { message_loop_.PostQuitTask(); },
+        ftl::TimeDelta::FromMilliseconds(10));
+    message_loop_.Run();
+    char buffer[kCapacity];
+    uint32_t num_bytes = sizeof(buffer);
+    if (ReadDataRaw(consumer.get(), buffer, &num_bytes,
+                    MOJO_READ_DATA_FLAG_NONE) != MOJO_RESULT_OK)
+      return std::string();
+    return std::string(buffer, num_bytes);
+  }
+
+  // Far less than a snapshot, so that every snapshot takes several writes.
+  static constexpr uint32_t kCapacity = 8;
+
+  mtl::MessageLoop message_loop_;
+  ApplicationManager manager_;
+  StatsService service_;
+};
+
+constexpr uint32_t StatsServiceStreamTest::kCapacity;
+
+TEST_F(StatsServiceStreamTest, FinishesSnapshotsAsRoomIsMade) {
+  MojoCreateDataPipeOptions options = {sizeof(MojoCreateDataPipeOptions),
+                                       MOJO_CREATE_DATA_PIPE_OPTIONS_FLAG_NONE,
+                                       1u, kCapacity};
+  DataPipe pipe(options);
+  // A long interval, so that only a snapshot that was cut short is resumed
+  // while the test runs.
+  service_.StreamSnapshots(60 * 1000, std::move(pipe.producer_handle));
+
+  std::string line;
+  for (int i = 0; i < 100 && line.find('\n') == std::string::npos; ++i)
+    line += ReadAvailable(pipe.consumer_handle);
+  ASSERT_NE(std::string::npos, line.find('\n'));
+  EXPECT_GT(line.size(), kCapacity);
+  EXPECT_EQ(0u, line.find("{\"timestamp_us\":"));
+  EXPECT_EQ(line.size() - 1, line.find('\n'));
+  EXPECT_EQ('}', line[line.size() - 2]);
+
+  // The next snapshot is not due yet.
+  EXPECT_EQ("", ReadAvailable(pipe.consumer_handle));
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,83 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/worker_pool.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace mojo {
+namespace {
+
+TEST(WorkerPoolTest, RunsTasksInOrderOfPriority) {
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool started = false;
+  bool released = false;
+  std::vector<std::string> order;
+  auto record = [&mutex, &order](std::string name) {
+    return [&mutex, &order, name] {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(name);
+    };
+  };
+
+  {
+    WorkerPool pool(1);
+    // Holds the only thread until everything else has been queued.
+    pool.PostTask([&] {
+      std::unique_lock<std::mutex> lock(mutex);
+      started = true;
+      condition.notify_all();
+      condition.wait(lock, [&released] { return released; });
+    });
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [&started] { return started; });
+    }
+    pool.PostTask(record("low1"), WorkerPool::Priority::kLow);
+    pool.PostTask(record("normal1"));
+    pool.PostTask(record("high1"), WorkerPool::Priority::kHigh);
+    pool.PostTask(record("low2"), WorkerPool::Priority::kLow);
+    pool.PostTask(record("high2"), WorkerPool::Priority::kHigh);
+    pool.PostTask(record("normal2"), WorkerPool::Priority::kNormal);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      released = true;
+    }
+    condition.notify_all();
+    // The destructor runs what is still queued before joining.
+  }
+
+  EXPECT_EQ(std::vector<std::string>(
+                {"high1", "high2", "normal1", "normal2", "low1", "low2"}),
+            order);
+}
+
+TEST(WorkerPoolTest, RunsTasksOnSeveralThreads) {
+  std::mutex mutex;
+  std::condition_variable condition;
+  size_t num_running = 0;
+  {
+    WorkerPool pool(2);
+    // Each task waits for the other, so both must run at once.
+    for (int i = 0; i < 2; ++i) {
+      pool.PostTask([&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++num_running;
+        condition.notify_all();
+        condition.wait(lock, [&num_running] { return num_running == 2; });
+      });
+    }
+  }
+  EXPECT_EQ(2u, num_running);
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,72 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/application_manager/worker_pool.h"
+
+#include <utility>
+
+#include "lib/ftl/logging.h"
+
+namespace mojo {
+
+WorkerPool::WorkerPool(size_t num_threads) {
+  FTL_DCHECK(num_threads > 0);
+  for (size_t i = 0; i < num_threads; ++i)
+    threads_.emplace_back([this] { Run(); });
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  task_available_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+void WorkerPool::PostTask(ftl::Closure task, Priority priority) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FTL_DCHECK(!shutting_down_);
+    tasks_[static_cast<size_t>(priority)].push_back(std::move(task));
+  }
+  task_available_.notify_one();
+}
+
+bool WorkerPool::IsShuttingDown() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shutting_down_;
+}
+
+void WorkerPool::Run() {
+  for (;;) {
+    ftl::Closure task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_available_.wait(lock,
+                           [this] { return shutting_down_ || HasTasks(); });
+      if (!HasTasks())
+        return;
+      for (auto& tasks : tasks_) {
+        if (!tasks.empty()) {
+          task = std::move(tasks.front());
+          tasks.pop_front();
+          break;
+        }
+      }
+    }
+    task();
+  }
+}
+
+bool WorkerPool::HasTasks() const {
+  for (const auto& tasks : tasks_) {
+    if (!tasks.empty())
+      return true;
+  }
+  return false;
+}
+
+}  // namespace mojo
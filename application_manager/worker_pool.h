@@ -0,0 +1,65 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_APPLICATION_MANAGER_WORKER_POOL_H_
+#define MOJO_APPLICATION_MANAGER_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+
+namespace mojo {
+
+// A fixed number of threads that run tasks which may block, such as opening
+// files or creating processes, so that the application manager's message loop
+// does not have to. Tasks run in order of priority and then in the order they
+// were posted, but several may run at once. The number of threads bounds how
+// many tasks run at once; the rest wait in the queue.
+//
+// Tasks must not touch the application manager's state directly; they should
+// post their results back to the message loop.
+class WorkerPool {
+ public:
+  enum class Priority {
+    kHigh,
+    kNormal,
+    kLow,
+  };
+
+  explicit WorkerPool(size_t num_threads);
+
+  // Runs the tasks that are already queued and then joins the threads.
+  ~WorkerPool();
+
+  void PostTask(ftl::Closure task, Priority priority = Priority::kNormal);
+
+  // Whether the pool is being destroyed. Tasks that wait on something outside
+  // the process should check this now and then and give up once it is true,
+  // since the destructor waits for them.
+  bool IsShuttingDown();
+
+ private:
+  static constexpr size_t kNumPriorities =
+      static_cast<size_t>(Priority::kLow) + 1;
+
+  void Run();
+  bool HasTasks() const;
+
+  std::mutex mutex_;
+  std::condition_variable task_available_;
+  std::deque<ftl::Closure> tasks_[kNumPriorities];
+  bool shutting_down_ = false;
+  std::vector<std::thread> threads_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_APPLICATION_MANAGER_WORKER_POOL_H_
@@ -0,0 +1,39 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <mojo/system/main.h>
+
+#include "mojo/public/cpp/application/application_impl_base.h"
+#include "mojo/public/cpp/application/run_application.h"
+#include "mojo/public/cpp/application/service_provider_impl.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/utility/run_loop.h"
+
+namespace {
+
+class TinyAcceptApp : public mojo::ApplicationImplBase {
+ public:
+  TinyAcceptApp() {}
+  ~TinyAcceptApp() override {}
+
+  // |mojo::ApplicationImplBase| override:
+  bool OnAcceptConnection(
+      mojo::ServiceProviderImpl* service_provider_impl) override {
+    // Rejecting the connection closes it, which tells the requestor that it
+    // got this far. Then quit, so that the next connection launches the
+    // application again.
+    mojo::RunLoop::current()->Quit();
+    return false;
+  }
+
+ private:
+  MOJO_DISALLOW_COPY_AND_ASSIGN(TinyAcceptApp);
+};
+
+}  // namespace
+
+MojoResult MojoMain(MojoHandle application_request) {
+  TinyAcceptApp tiny_accept_app;
+  return mojo::RunApplication(application_request, &tiny_accept_app);
+}
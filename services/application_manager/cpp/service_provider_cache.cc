@@ -0,0 +1,50 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/services/application_manager/cpp/service_provider_cache.h"
+
+#include <assert.h>
+
+namespace mojo {
+
+ServiceProviderCache::ServiceProviderCache(ApplicationConnector* connector)
+    : connector_(connector) {
+  assert(connector_);
+}
+
+ServiceProviderCache::~ServiceProviderCache() {}
+
+ServiceProvider* ServiceProviderCache::GetServiceProvider(
+    const std::string& application_name) {
+  Entry& entry = service_providers_[application_name];
+  if (!entry.service_provider || entry.closed) {
+    entry.service_provider.reset();
+    entry.closed = false;
+    connector_->ConnectToApplication(application_name,
+                                     GetProxy(&entry.service_provider));
+    // The handler only marks the entry, since it runs on the pointer that
+    // replacing the connection would destroy.
+    Entry* entry_ptr = &entry;
+    entry.service_provider.set_connection_error_handler(
+        [entry_ptr] { entry_ptr->closed = true; });
+  }
+  return entry.service_provider.get();
+}
+
+bool ServiceProviderCache::IsConnected(
+    const std::string& application_name) const {
+  auto it = service_providers_.find(application_name);
+  return it != service_providers_.end() && it->second.service_provider &&
+         !it->second.closed;
+}
+
+void ServiceProviderCache::Drop(const std::string& application_name) {
+  service_providers_.erase(application_name);
+}
+
+void ServiceProviderCache::Clear() {
+  service_providers_.clear();
+}
+
+}  // namespace mojo
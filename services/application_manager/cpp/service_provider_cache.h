@@ -0,0 +1,104 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A client library that keeps an application's connections to the
+// applications it uses, so that it asks the application manager to connect
+// to each of them once rather than for every service it needs.
+//
+// Each mojo.ApplicationConnector.ConnectToApplication call goes through the
+// application manager and has the target accept a new connection. The
+// ServiceProvider that the first call returns already talks to the target
+// directly, so requesting later services on it keeps the manager out of the
+// way:
+//
+//  class MyApp : public mojo::ApplicationImplBase {
+//   public:
+//    void OnInitialize() override {
+//      shell()->CreateApplicationConnector(mojo::GetProxy(&connector_));
+//      services_ = std::make_unique<mojo::ServiceProviderCache>(
+//          connector_.get());
+//    }
+//
+//    void Frob() {
+//      FrobberPtr frobber;
+//      services_->ConnectToService("mojo:frobber", mojo::GetProxy(&frobber));
+//      ...
+//    }
+//
+//   private:
+//    mojo::ApplicationConnectorPtr connector_;
+//    std::unique_ptr<mojo::ServiceProviderCache> services_;
+//  };
+
+#ifndef MOJO_SERVICES_APPLICATION_MANAGER_CPP_SERVICE_PROVIDER_CACHE_H_
+#define MOJO_SERVICES_APPLICATION_MANAGER_CPP_SERVICE_PROVIDER_CACHE_H_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "mojo/public/cpp/bindings/interface_request.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/interfaces/application/application_connector.mojom.h"
+#include "mojo/public/interfaces/application/service_provider.mojom.h"
+
+namespace mojo {
+
+// Keeps one connection to each application it has been asked for. A
+// connection that has closed, because the application quit or crashed, is
+// marked as soon as the closure is noticed and replaced by a new one the next
+// time the application is asked for, which launches the application again if
+// needed. Services requested before the closure is noticed are lost with the
+// connection.
+//
+// Applications see one connection however many services are requested, so
+// this should only be used for applications that serve each service the same
+// way regardless of the connection it was requested on.
+class ServiceProviderCache {
+ public:
+  // |connector| must outlive this object.
+  explicit ServiceProviderCache(ApplicationConnector* connector);
+  ~ServiceProviderCache();
+
+  // Returns the connection to |application_name|, connecting to it if there
+  // is no open connection yet.
+  ServiceProvider* GetServiceProvider(const std::string& application_name);
+
+  // Returns whether there is a connection to |application_name| that is not
+  // known to have closed.
+  bool IsConnected(const std::string& application_name) const;
+
+  // Requests |service_name| from |application_name| on its cached connection.
+  template <typename Interface>
+  void ConnectToService(const std::string& application_name,
+                        InterfaceRequest<Interface> request,
+                        const std::string& service_name = Interface::Name_) {
+    GetServiceProvider(application_name)
+        ->ConnectToService(service_name, request.PassMessagePipe());
+  }
+
+  // Closes the connection to |application_name|, if there is one.
+  void Drop(const std::string& application_name);
+
+  // Closes every connection.
+  void Clear();
+
+ private:
+  struct Entry {
+    ServiceProviderPtr service_provider;
+    // Set by |service_provider|'s connection error handler.
+    bool closed = false;
+  };
+
+  ApplicationConnector* const connector_;
+  // The entries do not move once inserted, so the error handlers may point at
+  // them.
+  std::unordered_map<std::string, Entry> service_providers_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ServiceProviderCache);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_SERVICES_APPLICATION_MANAGER_CPP_SERVICE_PROVIDER_CACHE_H_
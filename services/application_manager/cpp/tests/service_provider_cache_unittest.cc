@@ -0,0 +1,179 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/services/application_manager/cpp/service_provider_cache.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/cpp/environment/environment.h"
+#include "mojo/public/cpp/system/message_pipe.h"
+#include "mojo/public/cpp/utility/run_loop.h"
+
+namespace mojo {
+namespace {
+
+// Records the services requested on one connection.
+class FakeServiceProvider : public ServiceProvider {
+ public:
+  explicit FakeServiceProvider(InterfaceRequest<ServiceProvider> request)
+      : binding_(this, std::move(request)) {
+    binding_.set_connection_error_handler([this] { client_closed_ = true; });
+  }
+
+  void ConnectToService(const String& service_name,
+                        ScopedMessagePipeHandle client_handle) override {
+    service_names_.push_back(service_name);
+  }
+
+  const std::vector<std::string>& service_names() const {
+    return service_names_;
+  }
+
+  // Whether the cache has closed its end of the connection.
+  bool client_closed() const { return client_closed_; }
+
+  // Closes the connection, as an application that quits would.
+  void Close() { binding_.Close(); }
+
+ private:
+  Binding<ServiceProvider> binding_;
+  std::vector<std::string> service_names_;
+  bool client_closed_ = false;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(FakeServiceProvider);
+};
+
+// Serves each connection with a |FakeServiceProvider| and keeps them all, by
+// application name, in the order they were made.
+class FakeApplicationConnector : public ApplicationConnector {
+ public:
+  FakeApplicationConnector() {}
+
+  void ConnectToApplication(
+      const String& application_name,
+      InterfaceRequest<ServiceProvider> services) override {
+    connections_[application_name].push_back(
+        std::make_unique<FakeServiceProvider>(std::move(services)));
+  }
+
+  void Duplicate(InterfaceRequest<ApplicationConnector> request) override {
+    ADD_FAILURE() << "Duplicate should not be called";
+  }
+
+  size_t GetConnectionCount(const std::string& application_name) {
+    return connections_[application_name].size();
+  }
+
+  FakeServiceProvider* GetLastConnection(const std::string& application_name) {
+    auto& connections = connections_[application_name];
+    return connections.empty() ? nullptr : connections.back().get();
+  }
+
+ private:
+  std::map<std::string, std::vector<std::unique_ptr<FakeServiceProvider>>>
+      connections_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(FakeApplicationConnector);
+};
+
+class ServiceProviderCacheTest : public testing::Test {
+ public:
+  ServiceProviderCacheTest() : cache_(&connector_) {}
+
+ protected:
+  void PumpMessages() { loop_.RunUntilIdle(); }
+
+  Environment env_;
+  RunLoop loop_;
+  FakeApplicationConnector connector_;
+  ServiceProviderCache cache_;
+};
+
+TEST_F(ServiceProviderCacheTest, ReusesConnection) {
+  ServiceProvider* first = cache_.GetServiceProvider("mojo:a");
+  ServiceProvider* second = cache_.GetServiceProvider("mojo:a");
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(1u, connector_.GetConnectionCount("mojo:a"));
+
+  cache_.GetServiceProvider("mojo:b");
+  EXPECT_EQ(1u, connector_.GetConnectionCount("mojo:a"));
+  EXPECT_EQ(1u, connector_.GetConnectionCount("mojo:b"));
+}
+
+TEST_F(ServiceProviderCacheTest, RequestsServicesOnOneConnection) {
+  MessagePipe first;
+  MessagePipe second;
+  cache_.GetServiceProvider("mojo:a")->ConnectToService(
+      "first", std::move(first.handle0));
+  cache_.GetServiceProvider("mojo:a")->ConnectToService(
+      "second", std::move(second.handle0));
+  PumpMessages();
+
+  ASSERT_EQ(1u, connector_.GetConnectionCount("mojo:a"));
+  const std::vector<std::string>& names =
+      connector_.GetLastConnection("mojo:a")->service_names();
+  ASSERT_EQ(2u, names.size());
+  EXPECT_EQ("first", names[0]);
+  EXPECT_EQ("second", names[1]);
+}
+
+TEST_F(ServiceProviderCacheTest, ReplacesClosedConnection) {
+  cache_.GetServiceProvider("mojo:a");
+  EXPECT_TRUE(cache_.IsConnected("mojo:a"));
+
+  connector_.GetLastConnection("mojo:a")->Close();
+  PumpMessages();
+  // The closure is noticed without asking for the application again.
+  EXPECT_FALSE(cache_.IsConnected("mojo:a"));
+  EXPECT_EQ(1u, connector_.GetConnectionCount("mojo:a"));
+
+  cache_.GetServiceProvider("mojo:a");
+  EXPECT_TRUE(cache_.IsConnected("mojo:a"));
+  EXPECT_EQ(2u, connector_.GetConnectionCount("mojo:a"));
+
+  // The replacement is watched like the first connection was.
+  connector_.GetLastConnection("mojo:a")->Close();
+  PumpMessages();
+  EXPECT_FALSE(cache_.IsConnected("mojo:a"));
+}
+
+TEST_F(ServiceProviderCacheTest, DropClosesConnection) {
+  cache_.GetServiceProvider("mojo:a");
+  cache_.GetServiceProvider("mojo:b");
+
+  cache_.Drop("mojo:a");
+  PumpMessages();
+  EXPECT_TRUE(connector_.GetLastConnection("mojo:a")->client_closed());
+  EXPECT_FALSE(connector_.GetLastConnection("mojo:b")->client_closed());
+  EXPECT_FALSE(cache_.IsConnected("mojo:a"));
+  EXPECT_TRUE(cache_.IsConnected("mojo:b"));
+
+  cache_.GetServiceProvider("mojo:a");
+  EXPECT_EQ(2u, connector_.GetConnectionCount("mojo:a"));
+  EXPECT_EQ(1u, connector_.GetConnectionCount("mojo:b"));
+
+  // Dropping an application that was never asked for does nothing.
+  cache_.Drop("mojo:c");
+  EXPECT_EQ(0u, connector_.GetConnectionCount("mojo:c"));
+}
+
+TEST_F(ServiceProviderCacheTest, ClearClosesEveryConnection) {
+  cache_.GetServiceProvider("mojo:a");
+  cache_.GetServiceProvider("mojo:b");
+
+  cache_.Clear();
+  PumpMessages();
+  EXPECT_TRUE(connector_.GetLastConnection("mojo:a")->client_closed());
+  EXPECT_TRUE(connector_.GetLastConnection("mojo:b")->client_closed());
+  EXPECT_FALSE(cache_.IsConnected("mojo:a"));
+  EXPECT_FALSE(cache_.IsConnected("mojo:b"));
+}
+
+}  // namespace
+}  // namespace mojo
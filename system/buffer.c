@@ -11,6 +11,7 @@
 #include <mojo/system/result.h>
 
 #include "mojo/system/mojo_export.h"
+#include "mojo/system/stats_internal.h"
 
 MOJO_EXPORT MojoResult
 MojoCreateSharedBuffer(const struct MojoCreateSharedBufferOptions* options,
@@ -31,6 +32,7 @@ MojoCreateSharedBuffer(const struct MojoCreateSharedBufferOptions* options,
     }
   }
   *shared_buffer_handle = (MojoHandle)mx_handle;
+  StatsAdd(MOJO_STATS_COUNTER_SHARED_BUFFER_HANDLES_CREATED, 1u);
   return MOJO_RESULT_OK;
 }
 
@@ -87,6 +89,7 @@ MOJO_EXPORT MojoResult MojoMapBuffer(MojoHandle buffer_handle,
                                          num_bytes, mx_pointer, mx_flags);
   switch (status) {
     case NO_ERROR:
+      StatsRecordMap(*mx_pointer, num_bytes);
       return MOJO_RESULT_OK;
     case ERR_INVALID_ARGS:
     case ERR_BAD_HANDLE:
@@ -109,6 +112,7 @@ MOJO_EXPORT MojoResult MojoUnmapBuffer(void* buffer) {
   mx_status_t status = mx_process_unmap_vm(mx_process_self(), address, length);
   switch (status) {
     case NO_ERROR:
+      StatsRecordUnmap(address);
       return MOJO_RESULT_OK;
     case ERR_INVALID_ARGS:
       return MOJO_SYSTEM_RESULT_INVALID_ARGUMENT;
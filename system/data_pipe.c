@@ -15,6 +15,7 @@
 
 #include "mojo/system/mojo_export.h"
 #include "mojo/system/options.h"
+#include "mojo/system/stats_internal.h"
 
 // TODO(vtl): Need assertion that |MojoCreateDataPipeOptions| flags and
 // |mx_datapipe_create()| flags are the same (currently, there are no flags).
@@ -75,6 +76,8 @@ MojoCreateDataPipe(const struct MojoCreateDataPipeOptions* options,
   }
   *data_pipe_producer_handle = (MojoHandle)mx_producer_handle;
   *data_pipe_consumer_handle = (MojoHandle)mx_consumer_handle;
+  StatsAdd(MOJO_STATS_COUNTER_DATA_PIPE_PRODUCER_HANDLES_CREATED, 1u);
+  StatsAdd(MOJO_STATS_COUNTER_DATA_PIPE_CONSUMER_HANDLES_CREATED, 1u);
   return MOJO_RESULT_OK;
 }
 
@@ -194,6 +197,7 @@ MOJO_EXPORT MojoResult MojoWriteData(MojoHandle data_pipe_producer_handle,
     }
   }
   *num_bytes = mx_bytes_written;
+  StatsAdd(MOJO_STATS_COUNTER_DATA_BYTES_WRITTEN, (uint64_t)mx_bytes_written);
   return MOJO_RESULT_OK;
 }
 
@@ -232,6 +236,7 @@ MOJO_EXPORT MojoResult MojoEndWriteData(MojoHandle data_pipe_producer_handle,
       (mx_handle_t)data_pipe_producer_handle, num_bytes_written);
   switch (result) {
     case NO_ERROR:
+      StatsAdd(MOJO_STATS_COUNTER_DATA_BYTES_WRITTEN, num_bytes_written);
       return MOJO_RESULT_OK;
     case ERR_INVALID_ARGS:
     case ERR_BAD_HANDLE:
@@ -365,6 +370,9 @@ MOJO_EXPORT MojoResult MojoReadData(MojoHandle data_pipe_consumer_handle,
     return MOJO_SYSTEM_RESULT_UNKNOWN;
   }
   *num_bytes = bytes_read;
+  // Queries and peeks leave the data in the pipe.
+  if (!(flags & (MOJO_READ_DATA_FLAG_QUERY | MOJO_READ_DATA_FLAG_PEEK)))
+    StatsAdd(MOJO_STATS_COUNTER_DATA_BYTES_READ, (uint64_t)bytes_read);
   return MOJO_RESULT_OK;
 }
 
@@ -403,6 +411,7 @@ MOJO_EXPORT MojoResult MojoEndReadData(MojoHandle data_pipe_consumer_handle,
       (mx_handle_t)data_pipe_consumer_handle, num_bytes_read);
   switch (result) {
     case NO_ERROR:
+      StatsAdd(MOJO_STATS_COUNTER_DATA_BYTES_READ, num_bytes_read);
       return MOJO_RESULT_OK;
     case ERR_INVALID_ARGS:
     case ERR_BAD_HANDLE:
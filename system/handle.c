@@ -12,6 +12,7 @@
 #include <mojo/system/result.h>
 
 #include "mojo/system/mojo_export.h"
+#include "mojo/system/stats_internal.h"
 
 static_assert(MOJO_HANDLE_RIGHT_NONE == MX_RIGHT_NONE, "RIGHT_NONE must match");
 static_assert(MOJO_HANDLE_RIGHT_DUPLICATE == MX_RIGHT_DUPLICATE,
@@ -54,6 +55,7 @@ MOJO_EXPORT MojoResult MojoClose(MojoHandle handle) {
   mx_status_t status = mx_handle_close((mx_handle_t)handle);
   switch (status) {
     case NO_ERROR:
+      StatsAdd(MOJO_STATS_COUNTER_HANDLES_CLOSED, 1u);
       return MOJO_RESULT_OK;
     case ERR_BAD_HANDLE:
     case ERR_INVALID_ARGS:
@@ -142,6 +144,7 @@ MojoDuplicateHandleWithReducedRights(MojoHandle handle,
     }
   }
   *new_handle = (MojoHandle)new_mx_handle;
+  StatsAdd(MOJO_STATS_COUNTER_HANDLES_DUPLICATED, 1u);
   return MOJO_RESULT_OK;
 }
 
@@ -164,5 +167,6 @@ MOJO_EXPORT MojoResult MojoDuplicateHandle(MojoHandle handle,
     }
   }
   *new_handle = (MojoHandle)mx_new_handle;
+  StatsAdd(MOJO_STATS_COUNTER_HANDLES_DUPLICATED, 1u);
   return MOJO_RESULT_OK;
 }
@@ -7,10 +7,76 @@
 #include <mojo/system/message_pipe.h>
 
 #include <magenta/syscalls.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <mojo/system/message_pipe.h>
 #include <mojo/system/result.h>
 
+#include "mojo/system/message_pipe_ext.h"
 #include "mojo/system/mojo_export.h"
+#include "mojo/system/stats_internal.h"
+
+// Handle slots for |MojoReadMessageWithReservedHandles()| and
+// |MojoReadMessageBuffered()|.
+static _Thread_local mx_handle_t
+    reserved_handles[MOJO_MESSAGE_MAX_NUM_HANDLES];
+
+// The per-thread buffers for |MojoReadMessageBuffered()| are allocated on
+// first use (most threads never use them) and freed when the thread exits.
+static pthread_once_t thread_buffer_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_buffer_key;
+static bool thread_buffer_key_created = false;
+
+static void CreateThreadBufferKey(void) {
+  thread_buffer_key_created =
+      pthread_key_create(&thread_buffer_key, free) == 0;
+}
+
+static void* GetThreadBuffer(void) {
+  pthread_once(&thread_buffer_key_once, CreateThreadBufferKey);
+  if (!thread_buffer_key_created)
+    return NULL;
+  void* buffer = pthread_getspecific(thread_buffer_key);
+  if (!buffer) {
+    buffer = malloc(MOJO_MESSAGE_MAX_NUM_BYTES);
+    if (buffer && pthread_setspecific(thread_buffer_key, buffer) != 0) {
+      free(buffer);
+      buffer = NULL;
+    }
+  }
+  return buffer;
+}
+
+static MojoResult ReadStatusToMojoResult(mx_status_t status) {
+  switch (status) {
+    case NO_ERROR:
+      return MOJO_RESULT_OK;
+    case ERR_INVALID_ARGS:
+    case ERR_BAD_HANDLE:
+    case ERR_WRONG_TYPE:
+      return MOJO_SYSTEM_RESULT_INVALID_ARGUMENT;
+    case ERR_ACCESS_DENIED:
+      return MOJO_SYSTEM_RESULT_PERMISSION_DENIED;
+    case ERR_SHOULD_WAIT:
+      return MOJO_SYSTEM_RESULT_SHOULD_WAIT;
+    case ERR_REMOTE_CLOSED:
+      return MOJO_SYSTEM_RESULT_FAILED_PRECONDITION;
+    case ERR_NO_MEMORY:
+      // Notice the collision with ERR_NOT_ENOUGH_BUFFER.
+      return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
+    case ERR_BUFFER_TOO_SMALL:
+      return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
+    default:
+      return MOJO_SYSTEM_RESULT_UNKNOWN;
+  }
+}
+
+static void RecordMessageRead(uint32_t num_bytes, uint32_t num_handles) {
+  StatsAdd(MOJO_STATS_COUNTER_MESSAGES_READ, 1u);
+  StatsAdd(MOJO_STATS_COUNTER_MESSAGE_BYTES_READ, num_bytes);
+  StatsAdd(MOJO_STATS_COUNTER_HANDLES_RECEIVED, num_handles);
+}
 
 MOJO_EXPORT MojoResult
 MojoCreateMessagePipe(const struct MojoCreateMessagePipeOptions* options,
@@ -32,6 +98,7 @@ MojoCreateMessagePipe(const struct MojoCreateMessagePipeOptions* options,
   }
   *message_pipe_handle0 = (MojoHandle)mx_handles[0];
   *message_pipe_handle1 = (MojoHandle)mx_handles[1];
+  StatsAdd(MOJO_STATS_COUNTER_MESSAGE_PIPE_HANDLES_CREATED, 2u);
   return MOJO_RESULT_OK;
 }
 
@@ -48,6 +115,9 @@ MOJO_EXPORT MojoResult MojoWriteMessage(MojoHandle message_pipe_handle,
                        num_bytes, mx_handles, num_handles);
   switch (status) {
     case NO_ERROR:
+      StatsAdd(MOJO_STATS_COUNTER_MESSAGES_WRITTEN, 1u);
+      StatsAdd(MOJO_STATS_COUNTER_MESSAGE_BYTES_WRITTEN, num_bytes);
+      StatsAdd(MOJO_STATS_COUNTER_HANDLES_SENT, num_handles);
       return MOJO_RESULT_OK;
     case ERR_INVALID_ARGS:
     case ERR_BAD_HANDLE:
@@ -79,25 +149,94 @@ MOJO_EXPORT MojoResult MojoReadMessage(MojoHandle message_pipe_handle,
       mx_channel_read((mx_handle_t)message_pipe_handle, flags, bytes,
                       nbytes, num_bytes, mx_handles, nhandles,
                       num_handles);
-  switch (status) {
-    case NO_ERROR:
-      return MOJO_RESULT_OK;
-    case ERR_INVALID_ARGS:
-    case ERR_BAD_HANDLE:
-    case ERR_WRONG_TYPE:
-      return MOJO_SYSTEM_RESULT_INVALID_ARGUMENT;
-    case ERR_ACCESS_DENIED:
-      return MOJO_SYSTEM_RESULT_PERMISSION_DENIED;
-    case ERR_SHOULD_WAIT:
-      return MOJO_SYSTEM_RESULT_SHOULD_WAIT;
-    case ERR_REMOTE_CLOSED:
-      return MOJO_SYSTEM_RESULT_FAILED_PRECONDITION;
-    case ERR_NO_MEMORY:
-      // Notice the collision with ERR_NOT_ENOUGH_BUFFER.
-      return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
-    case ERR_BUFFER_TOO_SMALL:
-      return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
-    default:
-      return MOJO_SYSTEM_RESULT_UNKNOWN;
+  if (status == NO_ERROR) {
+    RecordMessageRead(num_bytes ? *num_bytes : 0u,
+                      num_handles ? *num_handles : 0u);
   }
+  return ReadStatusToMojoResult(status);
+}
+
+MOJO_EXPORT MojoResult MojoQueryMessage(MojoHandle message_pipe_handle,
+                                        uint32_t* num_bytes,
+                                        uint32_t* num_handles) {
+  // Reading into empty buffers fails with ERR_BUFFER_TOO_SMALL, leaving the
+  // message in the queue, but reports the size of the message. Only an empty
+  // message fits, in which case it has been read.
+  uint32_t actual_bytes = 0u;
+  uint32_t actual_handles = 0u;
+  mx_status_t status =
+      mx_channel_read((mx_handle_t)message_pipe_handle, 0u, NULL, 0u,
+                      &actual_bytes, NULL, 0u, &actual_handles);
+  if (status == NO_ERROR)
+    RecordMessageRead(0u, 0u);
+  else if (status != ERR_BUFFER_TOO_SMALL)
+    return ReadStatusToMojoResult(status);
+  if (num_bytes)
+    *num_bytes = actual_bytes;
+  if (num_handles)
+    *num_handles = actual_handles;
+  return MOJO_RESULT_OK;
+}
+
+MOJO_EXPORT MojoResult
+MojoReadMessageWithReservedHandles(MojoHandle message_pipe_handle,
+                                   void* bytes,
+                                   uint32_t* num_bytes,
+                                   const MojoHandle** handles,
+                                   uint32_t* num_handles,
+                                   MojoReadMessageFlags flags) {
+  uint32_t nbytes = num_bytes ? *num_bytes : 0u;
+  uint32_t actual_handles = 0u;
+  mx_status_t status = mx_channel_read(
+      (mx_handle_t)message_pipe_handle, flags, bytes, nbytes, num_bytes,
+      reserved_handles, MOJO_MESSAGE_MAX_NUM_HANDLES, &actual_handles);
+  if (status != NO_ERROR)
+    return ReadStatusToMojoResult(status);
+  RecordMessageRead(num_bytes ? *num_bytes : 0u, actual_handles);
+  *handles = (const MojoHandle*)reserved_handles;
+  *num_handles = actual_handles;
+  return MOJO_RESULT_OK;
+}
+
+MOJO_EXPORT MojoResult
+MojoReadMessageBuffered(MojoHandle message_pipe_handle,
+                                void** bytes,
+                                uint32_t* num_bytes,
+                                const MojoHandle** handles,
+                                uint32_t* num_handles,
+                                MojoReadMessageFlags flags) {
+  void* buffer = GetThreadBuffer();
+  if (!buffer)
+    return MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED;
+  uint32_t actual_bytes = 0u;
+  uint32_t actual_handles = 0u;
+  mx_status_t status = mx_channel_read(
+      (mx_handle_t)message_pipe_handle, flags, buffer,
+      MOJO_MESSAGE_MAX_NUM_BYTES, &actual_bytes, reserved_handles,
+      MOJO_MESSAGE_MAX_NUM_HANDLES, &actual_handles);
+  if (status != NO_ERROR)
+    return ReadStatusToMojoResult(status);
+  RecordMessageRead(actual_bytes, actual_handles);
+  *bytes = buffer;
+  *num_bytes = actual_bytes;
+  *handles = (const MojoHandle*)reserved_handles;
+  *num_handles = actual_handles;
+  return MOJO_RESULT_OK;
+}
+
+MOJO_EXPORT MojoResult MojoDiscardMessage(MojoHandle message_pipe_handle) {
+  uint32_t actual_bytes = 0u;
+  uint32_t actual_handles = 0u;
+  // With MAY_DISCARD, a message that does not fit the (empty) buffers is
+  // dropped by the kernel, which also closes its handles.
+  mx_status_t status = mx_channel_read(
+      (mx_handle_t)message_pipe_handle, MX_CHANNEL_READ_MAY_DISCARD, NULL, 0u,
+      &actual_bytes, NULL, 0u, &actual_handles);
+  if (status != NO_ERROR && status != ERR_BUFFER_TOO_SMALL)
+    return ReadStatusToMojoResult(status);
+  // The message is off the queue either way (an empty message fits, and is
+  // read). Its handles were closed by the kernel, so none were received.
+  StatsAdd(MOJO_STATS_COUNTER_MESSAGES_READ, 1u);
+  StatsAdd(MOJO_STATS_COUNTER_MESSAGE_BYTES_READ, actual_bytes);
+  return MOJO_RESULT_OK;
 }
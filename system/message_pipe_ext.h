@@ -0,0 +1,123 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Extensions to <mojo/system/message_pipe.h> provided by libmojo.
+
+#ifndef MOJO_SYSTEM_MESSAGE_PIPE_EXT_H_
+#define MOJO_SYSTEM_MESSAGE_PIPE_EXT_H_
+
+#include <mojo/macros.h>
+#include <mojo/result.h>
+#include <mojo/system/handle.h>
+#include <mojo/system/message_pipe.h>
+#include <stdint.h>
+
+// The maximum number of bytes and handles that a single message can carry.
+// (These are the limits imposed by Magenta channels.)
+#define MOJO_MESSAGE_MAX_NUM_BYTES 65536u
+#define MOJO_MESSAGE_MAX_NUM_HANDLES 64u
+
+MOJO_BEGIN_EXTERN_C
+
+// |MojoQueryMessage()|: Reports the size of the message at the front of the
+// queue of the message pipe endpoint given by |message_pipe_handle|. On
+// success, |*num_bytes| is set to the number of bytes and |*num_handles| to the
+// number of handles in the message (either may be null if the caller is not
+// interested).
+//
+// Unlike probing with |MojoReadMessage()| with too small a buffer, this always
+// reports the handle count along with the byte count, so the subsequent read
+// can be sized exactly.
+//
+// Note: Magenta channels cannot be peeked, so a message with no bytes and no
+// handles cannot be sized without being read. Such a message is read by this
+// call: when both counts are zero, the empty message has already been taken off
+// the queue and there is nothing more to read for it. Any other message is left
+// at the front of the queue.
+//
+// Returns:
+//   |MOJO_RESULT_OK| if there is a message to query.
+//   |MOJO_SYSTEM_RESULT_INVALID_ARGUMENT| if |message_pipe_handle| is not a
+//       valid message pipe handle.
+//   |MOJO_SYSTEM_RESULT_PERMISSION_DENIED| if |message_pipe_handle| does not
+//       have the |MOJO_HANDLE_RIGHT_READ| right.
+//   |MOJO_SYSTEM_RESULT_SHOULD_WAIT| if there is no message to query.
+//   |MOJO_SYSTEM_RESULT_FAILED_PRECONDITION| if there is no message and the
+//       peer has been closed.
+MojoResult MojoQueryMessage(MojoHandle message_pipe_handle,  // In.
+                            uint32_t* num_bytes,             // Optional out.
+                            uint32_t* num_handles);          // Optional out.
+
+// |MojoReadMessageWithReservedHandles()|: Like |MojoReadMessage()|, but the
+// message's handles are read into an array of |MOJO_MESSAGE_MAX_NUM_HANDLES|
+// slots reserved for the calling thread, so a message carrying handles never
+// fails with |MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED| because of its handles.
+//
+// On success, |*handles| points to the calling thread's reserved array and
+// |*num_handles| is set to the number of handles read into it. The caller owns
+// the handles, but the array itself is only valid until the next call to this
+// function (or |MojoReadMessageBuffered()|) on the same thread, so the caller
+// should move the handles out of it before then.
+//
+// |bytes| and |num_bytes| behave as for |MojoReadMessage()|.
+MojoResult MojoReadMessageWithReservedHandles(
+    MojoHandle message_pipe_handle,  // In.
+    void* bytes,                     // Optional out.
+    uint32_t* num_bytes,             // Optional in/out.
+    const MojoHandle** handles,      // Out.
+    uint32_t* num_handles,           // Out.
+    MojoReadMessageFlags flags);     // In.
+
+// |MojoReadMessageBuffered()|: A buffered read. Reads the message at the front
+// of the queue of the message pipe endpoint given by |message_pipe_handle| into
+// a buffer of |MOJO_MESSAGE_MAX_NUM_BYTES| that libmojo allocates for the
+// calling thread on first use, instead of into a caller-supplied buffer.
+//
+// This is not a peek and does not map the message: like any read, it takes the
+// message off the queue and copies it out of the kernel. It only saves the
+// caller from sizing and allocating a buffer of its own. Routers and proxies
+// can inspect a message's header in the buffer and then forward it (by passing
+// the buffer straight to |MojoWriteMessage()|) or drop it.
+//
+// On success, |*bytes| points to the buffer and |*num_bytes| is set to the
+// message size; |*handles| points to the calling thread's reserved handle array
+// (see |MojoReadMessageWithReservedHandles()|) and |*num_handles| is set to the
+// number of handles. The buffer and the array are only valid until the next
+// call to this function (or |MojoReadMessageWithReservedHandles()|) on the same
+// thread, so anything that needs the message after that must copy it. The
+// caller may modify the buffer. The caller owns the handles and must close or
+// transfer them.
+//
+// Callers that only need to drop a message should use |MojoDiscardMessage()|,
+// which never copies it out.
+//
+// Returns the same results as |MojoReadMessage()|, except that it only returns
+// |MOJO_SYSTEM_RESULT_RESOURCE_EXHAUSTED| if the buffer could not be
+// allocated, never because of the message's size.
+MojoResult MojoReadMessageBuffered(
+    MojoHandle message_pipe_handle,  // In.
+    void** bytes,                    // Out.
+    uint32_t* num_bytes,             // Out.
+    const MojoHandle** handles,      // Out.
+    uint32_t* num_handles,           // Out.
+    MojoReadMessageFlags flags);     // In.
+
+// |MojoDiscardMessage()|: Removes the message at the front of the queue of the
+// message pipe endpoint given by |message_pipe_handle| without copying it into
+// this process. Any handles in the message are closed.
+//
+// Returns:
+//   |MOJO_RESULT_OK| if a message was discarded.
+//   |MOJO_SYSTEM_RESULT_INVALID_ARGUMENT| if |message_pipe_handle| is not a
+//       valid message pipe handle.
+//   |MOJO_SYSTEM_RESULT_PERMISSION_DENIED| if |message_pipe_handle| does not
+//       have the |MOJO_HANDLE_RIGHT_READ| right.
+//   |MOJO_SYSTEM_RESULT_SHOULD_WAIT| if there is no message to discard.
+//   |MOJO_SYSTEM_RESULT_FAILED_PRECONDITION| if there is no message and the
+//       peer has been closed.
+MojoResult MojoDiscardMessage(MojoHandle message_pipe_handle);  // In.
+
+MOJO_END_EXTERN_C
+
+#endif  // MOJO_SYSTEM_MESSAGE_PIPE_EXT_H_
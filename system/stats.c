@@ -0,0 +1,130 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Definition of functions declared in "mojo/system/stats.h" and
+// "mojo/system/stats_internal.h".
+
+#include "mojo/system/stats.h"
+
+#include <mojo/system/result.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mojo/system/mojo_export.h"
+#include "mojo/system/stats_internal.h"
+
+atomic_uint_fast64_t mojo_stats_counters[MOJO_STATS_COUNTER_COUNT];
+
+// |MojoUnmapBuffer()| is only given the address, so the size of each mapping
+// is remembered here. Mapping is rare compared to message traffic, so a
+// locked array is good enough.
+struct Mapping {
+  uintptr_t address;
+  uint64_t num_bytes;
+};
+
+static pthread_mutex_t mappings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct Mapping* mappings = NULL;
+static size_t num_mappings = 0u;
+static size_t mappings_capacity = 0u;
+static uint64_t mapped_num_bytes = 0u;
+
+void StatsRecordMap(uintptr_t address, uint64_t num_bytes) {
+  pthread_mutex_lock(&mappings_mutex);
+  if (num_mappings == mappings_capacity) {
+    size_t new_capacity = mappings_capacity ? mappings_capacity * 2u : 16u;
+    struct Mapping* new_mappings =
+        realloc(mappings, new_capacity * sizeof(struct Mapping));
+    if (!new_mappings) {
+      // Losing track of a mapping only makes the statistics inaccurate.
+      pthread_mutex_unlock(&mappings_mutex);
+      return;
+    }
+    mappings = new_mappings;
+    mappings_capacity = new_capacity;
+  }
+  mappings[num_mappings].address = address;
+  mappings[num_mappings].num_bytes = num_bytes;
+  num_mappings++;
+  mapped_num_bytes += num_bytes;
+  pthread_mutex_unlock(&mappings_mutex);
+}
+
+void StatsRecordUnmap(uintptr_t address) {
+  pthread_mutex_lock(&mappings_mutex);
+  for (size_t i = 0u; i < num_mappings; i++) {
+    if (mappings[i].address == address) {
+      mapped_num_bytes -= mappings[i].num_bytes;
+      mappings[i] = mappings[--num_mappings];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&mappings_mutex);
+}
+
+static uint64_t LoadCounter(enum MojoStatsCounter counter) {
+  return atomic_load_explicit(&mojo_stats_counters[counter],
+                              memory_order_relaxed);
+}
+
+MOJO_EXPORT MojoResult MojoGetSystemStats(struct MojoSystemStats* stats,
+                                          uint32_t stats_num_bytes) {
+  if (!stats || stats_num_bytes < sizeof(struct MojoSystemStats))
+    return MOJO_SYSTEM_RESULT_INVALID_ARGUMENT;
+
+  struct MojoSystemStats snapshot;
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.struct_size = sizeof(struct MojoSystemStats);
+
+  snapshot.num_handles_duplicated =
+      LoadCounter(MOJO_STATS_COUNTER_HANDLES_DUPLICATED);
+  snapshot.num_handles_received =
+      LoadCounter(MOJO_STATS_COUNTER_HANDLES_RECEIVED);
+  snapshot.num_handles_closed = LoadCounter(MOJO_STATS_COUNTER_HANDLES_CLOSED);
+  snapshot.num_handles_sent = LoadCounter(MOJO_STATS_COUNTER_HANDLES_SENT);
+
+  snapshot.num_message_pipe_handles_created =
+      LoadCounter(MOJO_STATS_COUNTER_MESSAGE_PIPE_HANDLES_CREATED);
+  snapshot.num_data_pipe_producer_handles_created =
+      LoadCounter(MOJO_STATS_COUNTER_DATA_PIPE_PRODUCER_HANDLES_CREATED);
+  snapshot.num_data_pipe_consumer_handles_created =
+      LoadCounter(MOJO_STATS_COUNTER_DATA_PIPE_CONSUMER_HANDLES_CREATED);
+  snapshot.num_shared_buffer_handles_created =
+      LoadCounter(MOJO_STATS_COUNTER_SHARED_BUFFER_HANDLES_CREATED);
+  snapshot.num_wait_set_handles_created =
+      LoadCounter(MOJO_STATS_COUNTER_WAIT_SET_HANDLES_CREATED);
+  snapshot.num_handles_created =
+      snapshot.num_message_pipe_handles_created +
+      snapshot.num_data_pipe_producer_handles_created +
+      snapshot.num_data_pipe_consumer_handles_created +
+      snapshot.num_shared_buffer_handles_created +
+      snapshot.num_wait_set_handles_created;
+
+  uint64_t num_gained = snapshot.num_handles_created +
+                        snapshot.num_handles_duplicated +
+                        snapshot.num_handles_received;
+  uint64_t num_lost = snapshot.num_handles_closed + snapshot.num_handles_sent;
+  snapshot.num_handles = num_gained > num_lost ? num_gained - num_lost : 0u;
+
+  pthread_mutex_lock(&mappings_mutex);
+  snapshot.num_mappings = num_mappings;
+  snapshot.mapped_num_bytes = mapped_num_bytes;
+  pthread_mutex_unlock(&mappings_mutex);
+
+  snapshot.num_messages_written =
+      LoadCounter(MOJO_STATS_COUNTER_MESSAGES_WRITTEN);
+  snapshot.num_messages_read = LoadCounter(MOJO_STATS_COUNTER_MESSAGES_READ);
+  snapshot.message_num_bytes_written =
+      LoadCounter(MOJO_STATS_COUNTER_MESSAGE_BYTES_WRITTEN);
+  snapshot.message_num_bytes_read =
+      LoadCounter(MOJO_STATS_COUNTER_MESSAGE_BYTES_READ);
+  snapshot.data_num_bytes_written =
+      LoadCounter(MOJO_STATS_COUNTER_DATA_BYTES_WRITTEN);
+  snapshot.data_num_bytes_read =
+      LoadCounter(MOJO_STATS_COUNTER_DATA_BYTES_READ);
+
+  memcpy(stats, &snapshot, sizeof(snapshot));
+  return MOJO_RESULT_OK;
+}
@@ -0,0 +1,78 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Per-process accounting of the resources held through libmojo.
+
+#ifndef MOJO_SYSTEM_STATS_H_
+#define MOJO_SYSTEM_STATS_H_
+
+#include <mojo/macros.h>
+#include <mojo/result.h>
+#include <stdint.h>
+
+// |MojoSystemStats|: A snapshot of the resources this process holds through
+// libmojo.
+//
+// Handles are counted as they pass through libmojo, without keeping track of
+// each one, so that creating, closing, sending and receiving a handle costs
+// only an atomic increment. |num_handles| is those created, duplicated or
+// received in a message, less those closed or sent. Closing a handle that the
+// process got some other way, such as a startup handle, also counts, so
+// |num_handles| is a trend to watch for leaks rather than an exact census.
+// Which kinds of handles a process holds is told by the per-type counts of
+// handles created, which only grow.
+//
+// The byte counters are totals since the process started. For a pipe that is
+// both written and read in this process, written minus read is what is still
+// queued.
+struct MOJO_ALIGNAS(8) MojoSystemStats {
+  uint32_t struct_size;
+  uint32_t reserved;
+
+  uint64_t num_handles;
+  uint64_t num_handles_created;
+  uint64_t num_handles_duplicated;
+  uint64_t num_handles_received;
+  uint64_t num_handles_closed;
+  uint64_t num_handles_sent;
+
+  uint64_t num_message_pipe_handles_created;
+  uint64_t num_data_pipe_producer_handles_created;
+  uint64_t num_data_pipe_consumer_handles_created;
+  uint64_t num_shared_buffer_handles_created;
+  uint64_t num_wait_set_handles_created;
+
+  uint64_t num_mappings;
+  uint64_t mapped_num_bytes;
+
+  uint64_t num_messages_written;
+  uint64_t num_messages_read;
+  uint64_t message_num_bytes_written;
+  uint64_t message_num_bytes_read;
+  uint64_t data_num_bytes_written;
+  uint64_t data_num_bytes_read;
+};
+MOJO_STATIC_ASSERT(sizeof(struct MojoSystemStats) == 160,
+                   "MojoSystemStats has wrong size");
+
+MOJO_BEGIN_EXTERN_C
+
+// |MojoGetSystemStats()|: Gets a snapshot of this process's libmojo resource
+// usage. |stats| must be non-null and |stats_num_bytes| must be at least
+// |sizeof(struct MojoSystemStats)|; exactly that many bytes are written, and
+// |stats->struct_size| is set to it.
+//
+// The counters are updated without locking, so a snapshot taken while other
+// threads are using libmojo is not atomic across fields.
+//
+// Returns:
+//   |MOJO_RESULT_OK| on success.
+//   |MOJO_SYSTEM_RESULT_INVALID_ARGUMENT| if |stats| is null or
+//       |stats_num_bytes| is too small.
+MojoResult MojoGetSystemStats(struct MojoSystemStats* stats,  // Out.
+                              uint32_t stats_num_bytes);      // In.
+
+MOJO_END_EXTERN_C
+
+#endif  // MOJO_SYSTEM_STATS_H_
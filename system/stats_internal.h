@@ -0,0 +1,46 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Counters behind |MojoGetSystemStats()|, updated by the rest of libmojo.
+
+#ifndef MOJO_SYSTEM_STATS_INTERNAL_H_
+#define MOJO_SYSTEM_STATS_INTERNAL_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+enum MojoStatsCounter {
+  MOJO_STATS_COUNTER_HANDLES_DUPLICATED,
+  MOJO_STATS_COUNTER_HANDLES_RECEIVED,
+  MOJO_STATS_COUNTER_HANDLES_CLOSED,
+  MOJO_STATS_COUNTER_HANDLES_SENT,
+  MOJO_STATS_COUNTER_MESSAGE_PIPE_HANDLES_CREATED,
+  MOJO_STATS_COUNTER_DATA_PIPE_PRODUCER_HANDLES_CREATED,
+  MOJO_STATS_COUNTER_DATA_PIPE_CONSUMER_HANDLES_CREATED,
+  MOJO_STATS_COUNTER_SHARED_BUFFER_HANDLES_CREATED,
+  MOJO_STATS_COUNTER_WAIT_SET_HANDLES_CREATED,
+  MOJO_STATS_COUNTER_MESSAGES_WRITTEN,
+  MOJO_STATS_COUNTER_MESSAGES_READ,
+  MOJO_STATS_COUNTER_MESSAGE_BYTES_WRITTEN,
+  MOJO_STATS_COUNTER_MESSAGE_BYTES_READ,
+  MOJO_STATS_COUNTER_DATA_BYTES_WRITTEN,
+  MOJO_STATS_COUNTER_DATA_BYTES_READ,
+  MOJO_STATS_COUNTER_COUNT,
+};
+
+extern atomic_uint_fast64_t mojo_stats_counters[MOJO_STATS_COUNTER_COUNT];
+
+// Relaxed ordering is enough: the counters are independent and only read for
+// reporting.
+static inline void StatsAdd(enum MojoStatsCounter counter, uint64_t delta) {
+  atomic_fetch_add_explicit(&mojo_stats_counters[counter], delta,
+                            memory_order_relaxed);
+}
+
+// Records that |num_bytes| of a buffer have been mapped at |address|, and that
+// the mapping at |address| has been removed, respectively.
+void StatsRecordMap(uintptr_t address, uint64_t num_bytes);
+void StatsRecordUnmap(uintptr_t address);
+
+#endif  // MOJO_SYSTEM_STATS_INTERNAL_H_
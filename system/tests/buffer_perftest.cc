@@ -0,0 +1,73 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <mojo/result.h>
+#include <mojo/system/buffer.h>
+#include <mojo/system/handle.h>
+#include <stdio.h>
+
+#include "gtest/gtest.h"
+#include "mojo/system/tests/perftest_utils.h"
+
+namespace mojo {
+namespace system {
+namespace test {
+namespace {
+
+const uint64_t kBufferSizes[] = {4096u, 64u * 1024u, 1024u * 1024u};
+
+void FormatSize(uint64_t num_bytes, char* buffer, size_t buffer_size) {
+  if (num_bytes >= 1024u * 1024u) {
+    snprintf(buffer, buffer_size, "%lluMB",
+             static_cast<unsigned long long>(num_bytes / (1024u * 1024u)));
+  } else {
+    snprintf(buffer, buffer_size, "%lluKB",
+             static_cast<unsigned long long>(num_bytes / 1024u));
+  }
+}
+
+// Measures the cost of creating and closing a shared buffer.
+TEST(BufferPerfTest, CreateAndClose) {
+  for (uint64_t num_bytes : kBufferSizes) {
+    PerfRun run = RunForDuration([num_bytes]() {
+      MojoHandle handle = MOJO_HANDLE_INVALID;
+      return CheckOk(MojoCreateSharedBuffer(nullptr, num_bytes, &handle)) &&
+             CheckOk(MojoClose(handle));
+    });
+    ASSERT_TRUE(run.succeeded);
+
+    char sub_test_name[32];
+    FormatSize(num_bytes, sub_test_name, sizeof(sub_test_name));
+    ReportMicrosecondsPerIteration("Buffer_CreateAndClose", sub_test_name,
+                                   run);
+  }
+}
+
+// Measures the cost of mapping and unmapping an existing shared buffer.
+TEST(BufferPerfTest, MapAndUnmap) {
+  for (uint64_t num_bytes : kBufferSizes) {
+    MojoHandle handle = MOJO_HANDLE_INVALID;
+    ASSERT_EQ(MOJO_RESULT_OK,
+              MojoCreateSharedBuffer(nullptr, num_bytes, &handle));
+
+    PerfRun run = RunForDuration([handle, num_bytes]() {
+      void* address = nullptr;
+      return CheckOk(MojoMapBuffer(handle, 0u, num_bytes, &address,
+                                   MOJO_MAP_BUFFER_FLAG_NONE)) &&
+             CheckOk(MojoUnmapBuffer(address));
+    });
+
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(handle));
+    ASSERT_TRUE(run.succeeded);
+
+    char sub_test_name[32];
+    FormatSize(num_bytes, sub_test_name, sizeof(sub_test_name));
+    ReportMicrosecondsPerIteration("Buffer_MapAndUnmap", sub_test_name, run);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace system
+}  // namespace mojo
@@ -0,0 +1,275 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <mojo/result.h>
+#include <mojo/system/buffer.h>
+#include <mojo/system/handle.h>
+#include <mojo/system/message_pipe.h>
+#include <mojo/system/wait.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/system/message_pipe_ext.h"
+#include "mojo/system/tests/perftest_utils.h"
+
+namespace mojo {
+namespace system {
+namespace test {
+namespace {
+
+const uint32_t kPayloadSizes[] = {8u, 64u, 1024u, 16384u};
+const uint32_t kHandleCounts[] = {0u, 1u, 4u, 16u};
+
+// Messages written ahead of the reader in the one-way throughput tests.
+constexpr uint32_t kBatchSize = 64u;
+
+// Sent (as a single byte message) to make the echo thread exit.
+constexpr char kQuitMessage = 'q';
+
+bool WaitReadable(MojoHandle handle) {
+  return MojoWait(handle, MOJO_HANDLE_SIGNAL_READABLE,
+                  MOJO_DEADLINE_INDEFINITE, nullptr) == MOJO_RESULT_OK;
+}
+
+// Echoes every message read from |handle| back to it until it reads the quit
+// message or the peer is closed.
+void EchoUntilQuit(MojoHandle handle, uint32_t max_num_bytes) {
+  std::vector<char> buffer(max_num_bytes);
+  for (;;) {
+    if (!WaitReadable(handle))
+      return;
+    uint32_t num_bytes = max_num_bytes;
+    if (MojoReadMessage(handle, buffer.data(), &num_bytes, nullptr, nullptr,
+                        MOJO_READ_MESSAGE_FLAG_NONE) != MOJO_RESULT_OK)
+      return;
+    if (num_bytes == 1u && buffer[0] == kQuitMessage)
+      return;
+    if (MojoWriteMessage(handle, buffer.data(), num_bytes, nullptr, 0u,
+                         MOJO_WRITE_MESSAGE_FLAG_NONE) != MOJO_RESULT_OK)
+      return;
+  }
+}
+
+class MessagePipePerfTest : public testing::Test {
+ public:
+  MessagePipePerfTest() {}
+
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(MOJO_RESULT_OK, MojoCreateMessagePipe(nullptr, &h0_, &h1_));
+  }
+
+  void TearDown() override {
+    if (h0_ != MOJO_HANDLE_INVALID)
+      EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h0_));
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(h1_));
+  }
+
+  MojoHandle h0_ = MOJO_HANDLE_INVALID;
+  MojoHandle h1_ = MOJO_HANDLE_INVALID;
+
+ private:
+  MOJO_DISALLOW_COPY_AND_ASSIGN(MessagePipePerfTest);
+};
+
+// Measures the round trip latency of a message bounced off another thread.
+TEST_F(MessagePipePerfTest, PingPong) {
+  for (uint32_t payload_size : kPayloadSizes) {
+    std::thread echo_thread(EchoUntilQuit, h1_, payload_size);
+    std::vector<char> buffer(payload_size, 'x');
+
+    PerfRun run = RunForDuration([this, &buffer, payload_size]() {
+      if (!CheckOk(MojoWriteMessage(h0_, buffer.data(), payload_size, nullptr,
+                                    0u, MOJO_WRITE_MESSAGE_FLAG_NONE)) ||
+          !CheckEq(true, WaitReadable(h0_)))
+        return false;
+      uint32_t num_bytes = payload_size;
+      return CheckOk(MojoReadMessage(h0_, buffer.data(), &num_bytes, nullptr,
+                                     nullptr, MOJO_READ_MESSAGE_FLAG_NONE)) &&
+             CheckEq(payload_size, num_bytes);
+    });
+
+    // The echo thread is stopped even if the run failed, so that it can be
+    // joined. If it cannot be sent the quit message, closing its peer stops
+    // it instead.
+    MojoResult quit_result =
+        MojoWriteMessage(h0_, &kQuitMessage, 1u, nullptr, 0u,
+                         MOJO_WRITE_MESSAGE_FLAG_NONE);
+    EXPECT_EQ(MOJO_RESULT_OK, quit_result);
+    if (quit_result != MOJO_RESULT_OK) {
+      MojoClose(h0_);
+      h0_ = MOJO_HANDLE_INVALID;
+    }
+    echo_thread.join();
+    ASSERT_TRUE(run.succeeded);
+
+    char sub_test_name[32];
+    snprintf(sub_test_name, sizeof(sub_test_name), "%uB", payload_size);
+    ReportMicrosecondsPerIteration("MessagePipe_PingPong", sub_test_name, run);
+  }
+}
+
+// Measures one-way throughput: a batch of messages is written to one end and
+// then drained from the other.
+TEST_F(MessagePipePerfTest, OneWayThroughput) {
+  for (uint32_t payload_size : kPayloadSizes) {
+    std::vector<char> buffer(payload_size, 'x');
+
+    PerfRun run = RunForDuration([this, &buffer, payload_size]() {
+      for (uint32_t i = 0; i < kBatchSize; i++) {
+        if (!CheckOk(MojoWriteMessage(h0_, buffer.data(), payload_size,
+                                      nullptr, 0u,
+                                      MOJO_WRITE_MESSAGE_FLAG_NONE)))
+          return false;
+      }
+      for (uint32_t i = 0; i < kBatchSize; i++) {
+        uint32_t num_bytes = payload_size;
+        if (!CheckOk(MojoReadMessage(h1_, buffer.data(), &num_bytes, nullptr,
+                                     nullptr, MOJO_READ_MESSAGE_FLAG_NONE)))
+          return false;
+      }
+      return true;
+    });
+    ASSERT_TRUE(run.succeeded);
+
+    char sub_test_name[32];
+    snprintf(sub_test_name, sizeof(sub_test_name), "%uB", payload_size);
+    ReportMegabytesPerSecond("MessagePipe_OneWayThroughput", sub_test_name,
+                             run, static_cast<uint64_t>(payload_size) *
+                                      kBatchSize);
+  }
+}
+
+// Like |OneWayThroughput|, but drains with |MojoReadMessageBuffered()|.
+TEST_F(MessagePipePerfTest, OneWayThroughputBuffered) {
+  for (uint32_t payload_size : kPayloadSizes) {
+    std::vector<char> buffer(payload_size, 'x');
+
+    PerfRun run = RunForDuration([this, &buffer, payload_size]() {
+      for (uint32_t i = 0; i < kBatchSize; i++) {
+        if (!CheckOk(MojoWriteMessage(h0_, buffer.data(), payload_size,
+                                      nullptr, 0u,
+                                      MOJO_WRITE_MESSAGE_FLAG_NONE)))
+          return false;
+      }
+      for (uint32_t i = 0; i < kBatchSize; i++) {
+        void* bytes = nullptr;
+        uint32_t num_bytes = 0u;
+        const MojoHandle* handles = nullptr;
+        uint32_t num_handles = 0u;
+        if (!CheckOk(MojoReadMessageBuffered(h1_, &bytes, &num_bytes,
+                                             &handles, &num_handles,
+                                             MOJO_READ_MESSAGE_FLAG_NONE)) ||
+            !CheckEq(payload_size, num_bytes))
+          return false;
+      }
+      return true;
+    });
+    ASSERT_TRUE(run.succeeded);
+
+    char sub_test_name[32];
+    snprintf(sub_test_name, sizeof(sub_test_name), "%uB", payload_size);
+    ReportMegabytesPerSecond("MessagePipe_OneWayThroughputBuffered",
+                             sub_test_name, run,
+                             static_cast<uint64_t>(payload_size) * kBatchSize);
+  }
+}
+
+// Measures the cost of transferring handles: the same set of handles is
+// written to one end, read from the other and then sent again.
+TEST_F(MessagePipePerfTest, HandleTransfer) {
+  for (uint32_t num_handles : kHandleCounts) {
+    // Any kind of handle will do; shared buffers need only one handle each.
+    std::vector<MojoHandle> handles(num_handles, MOJO_HANDLE_INVALID);
+    for (MojoHandle& handle : handles) {
+      ASSERT_EQ(MOJO_RESULT_OK,
+                MojoCreateSharedBuffer(nullptr, 4096u, &handle));
+    }
+    char byte = 'x';
+
+    PerfRun run = RunForDuration([this, &handles, &byte, num_handles]() {
+      if (!CheckOk(MojoWriteMessage(h0_, &byte, 1u, handles.data(),
+                                    num_handles,
+                                    MOJO_WRITE_MESSAGE_FLAG_NONE)))
+        return false;
+      uint32_t num_bytes = 1u;
+      uint32_t num_handles_read = num_handles;
+      return CheckOk(MojoReadMessage(h1_, &byte, &num_bytes, handles.data(),
+                                     &num_handles_read,
+                                     MOJO_READ_MESSAGE_FLAG_NONE)) &&
+             CheckEq(num_handles, num_handles_read);
+    });
+
+    for (MojoHandle handle : handles)
+      EXPECT_EQ(MOJO_RESULT_OK, MojoClose(handle));
+    ASSERT_TRUE(run.succeeded);
+
+    char sub_test_name[32];
+    snprintf(sub_test_name, sizeof(sub_test_name), "%uHandles", num_handles);
+    ReportMicrosecondsPerIteration("MessagePipe_HandleTransfer",
+                                   sub_test_name, run);
+  }
+}
+
+// Like |HandleTransfer|, but reads with |MojoReadMessageWithReservedHandles()|
+// so the reader does not need to know the handle count up front.
+TEST_F(MessagePipePerfTest, HandleTransferReservedHandles) {
+  for (uint32_t num_handles : kHandleCounts) {
+    std::vector<MojoHandle> handles(num_handles, MOJO_HANDLE_INVALID);
+    for (MojoHandle& handle : handles) {
+      ASSERT_EQ(MOJO_RESULT_OK,
+                MojoCreateSharedBuffer(nullptr, 4096u, &handle));
+    }
+    char byte = 'x';
+
+    PerfRun run = RunForDuration([this, &handles, &byte, num_handles]() {
+      if (!CheckOk(MojoWriteMessage(h0_, &byte, 1u, handles.data(),
+                                    num_handles,
+                                    MOJO_WRITE_MESSAGE_FLAG_NONE)))
+        return false;
+      uint32_t num_bytes = 1u;
+      const MojoHandle* handles_read = nullptr;
+      uint32_t num_handles_read = 0u;
+      if (!CheckOk(MojoReadMessageWithReservedHandles(
+              h1_, &byte, &num_bytes, &handles_read, &num_handles_read,
+              MOJO_READ_MESSAGE_FLAG_NONE)) ||
+          !CheckEq(num_handles, num_handles_read))
+        return false;
+      std::copy(handles_read, handles_read + num_handles_read,
+                handles.begin());
+      return true;
+    });
+
+    for (MojoHandle handle : handles)
+      EXPECT_EQ(MOJO_RESULT_OK, MojoClose(handle));
+    ASSERT_TRUE(run.succeeded);
+
+    char sub_test_name[32];
+    snprintf(sub_test_name, sizeof(sub_test_name), "%uHandles", num_handles);
+    ReportMicrosecondsPerIteration("MessagePipe_HandleTransferReservedHandles",
+                                   sub_test_name, run);
+  }
+}
+
+// Measures the cost of creating and closing a message pipe.
+TEST(MessagePipeCreationPerfTest, CreateAndClose) {
+  PerfRun run = RunForDuration([]() {
+    MojoHandle h0 = MOJO_HANDLE_INVALID;
+    MojoHandle h1 = MOJO_HANDLE_INVALID;
+    return CheckOk(MojoCreateMessagePipe(nullptr, &h0, &h1)) &&
+           CheckOk(MojoClose(h0)) && CheckOk(MojoClose(h1));
+  });
+  ASSERT_TRUE(run.succeeded);
+  ReportIterationsPerSecond("MessagePipe_CreateAndClose", nullptr, run);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace system
+}  // namespace mojo
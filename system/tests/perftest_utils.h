@@ -0,0 +1,106 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Helpers shared by the perf tests for the functions implemented in
+// //mojo/system.
+
+#ifndef MOJO_SYSTEM_TESTS_PERFTEST_UTILS_H_
+#define MOJO_SYSTEM_TESTS_PERFTEST_UTILS_H_
+
+#include <mojo/result.h>
+#include <mojo/system/time.h>
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+#include "mojo/public/cpp/test_support/test_support.h"
+
+namespace mojo {
+namespace system {
+namespace test {
+
+// How long each measurement runs for (in microseconds).
+constexpr MojoTimeTicks kPerfTestDuration = 1000 * 1000;
+
+// The result of running a single measurement.
+struct PerfRun {
+  uint64_t iterations;
+  MojoTimeTicks elapsed;  // In microseconds.
+  bool succeeded;         // False if an iteration failed.
+};
+
+// Runs |single_iteration| repeatedly until at least |kPerfTestDuration| has
+// elapsed. |single_iteration| should perform a small, fixed amount of work;
+// time is only checked every few iterations to keep the clock out of the
+// measurement.
+//
+// |single_iteration| returns whether it succeeded, and the run stops at the
+// first iteration that did not. (ASSERT_* would only return from
+// |single_iteration|, so it should use |CheckOk| and |CheckEq| instead.)
+template <typename SingleIteration>
+PerfRun RunForDuration(SingleIteration single_iteration) {
+  constexpr uint64_t kIterationsPerTimeCheck = 16u;
+  PerfRun run = {0u, 0, true};
+  MojoTimeTicks start = MojoGetTimeTicksNow();
+  do {
+    for (uint64_t i = 0; i < kIterationsPerTimeCheck; i++) {
+      if (!single_iteration()) {
+        run.succeeded = false;
+        run.elapsed = MojoGetTimeTicksNow() - start;
+        return run;
+      }
+    }
+    run.iterations += kIterationsPerTimeCheck;
+    run.elapsed = MojoGetTimeTicksNow() - start;
+  } while (run.elapsed < kPerfTestDuration);
+  return run;
+}
+
+// Like EXPECT_EQ(MOJO_RESULT_OK, result), but returns whether it passed.
+inline bool CheckOk(MojoResult result) {
+  EXPECT_EQ(MOJO_RESULT_OK, result);
+  return result == MOJO_RESULT_OK;
+}
+
+// Like EXPECT_EQ(expected, actual), but returns whether it passed.
+template <typename T, typename U>
+bool CheckEq(const T& expected, const U& actual) {
+  EXPECT_EQ(expected, actual);
+  return expected == actual;
+}
+
+inline void ReportIterationsPerSecond(const char* test_name,
+                                      const char* sub_test_name,
+                                      const PerfRun& run) {
+  mojo::test::LogPerfResult(
+      test_name, sub_test_name,
+      static_cast<double>(run.iterations) * 1000000.0 / run.elapsed,
+      "iterations/second");
+}
+
+inline void ReportMicrosecondsPerIteration(const char* test_name,
+                                           const char* sub_test_name,
+                                           const PerfRun& run) {
+  mojo::test::LogPerfResult(
+      test_name, sub_test_name,
+      static_cast<double>(run.elapsed) / run.iterations, "microseconds");
+}
+
+// Reports the throughput of |run|, where each iteration moved
+// |bytes_per_iteration| bytes.
+inline void ReportMegabytesPerSecond(const char* test_name,
+                                     const char* sub_test_name,
+                                     const PerfRun& run,
+                                     uint64_t bytes_per_iteration) {
+  mojo::test::LogPerfResult(
+      test_name, sub_test_name,
+      static_cast<double>(run.iterations * bytes_per_iteration) /
+          run.elapsed,  // Bytes per microsecond is megabytes per second.
+      "MB/s");
+}
+
+}  // namespace test
+}  // namespace system
+}  // namespace mojo
+
+#endif  // MOJO_SYSTEM_TESTS_PERFTEST_UTILS_H_
@@ -0,0 +1,91 @@
+// Copyright 2016 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <mojo/result.h>
+#include <mojo/system/handle.h>
+#include <mojo/system/message_pipe.h>
+#include <mojo/system/wait_set.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mojo/system/tests/perftest_utils.h"
+
+namespace mojo {
+namespace system {
+namespace test {
+namespace {
+
+const uint32_t kNumHandles[] = {1u, 10u, 100u, 1000u, 10000u, 100000u};
+
+// Measures how |MojoWaitSetAdd()|, |MojoWaitSetWait()| and
+// |MojoWaitSetRemove()| scale with the number of handles in the wait set.
+// Exactly one handle is readable while waiting, which is the common case for
+// a message loop servicing many mostly idle pipes.
+TEST(WaitSetPerfTest, Scaling) {
+  for (uint32_t num_handles : kNumHandles) {
+    MojoHandle wait_set = MOJO_HANDLE_INVALID;
+    ASSERT_EQ(MOJO_RESULT_OK, MojoCreateWaitSet(nullptr, &wait_set));
+
+    // |waited[i]| is in the wait set; |peers[i]| is used to make it readable.
+    std::vector<MojoHandle> waited(num_handles, MOJO_HANDLE_INVALID);
+    std::vector<MojoHandle> peers(num_handles, MOJO_HANDLE_INVALID);
+    for (uint32_t i = 0; i < num_handles; i++) {
+      ASSERT_EQ(MOJO_RESULT_OK,
+                MojoCreateMessagePipe(nullptr, &waited[i], &peers[i]));
+    }
+
+    MojoTimeTicks start = MojoGetTimeTicksNow();
+    for (uint32_t i = 0; i < num_handles; i++) {
+      ASSERT_EQ(MOJO_RESULT_OK,
+                MojoWaitSetAdd(wait_set, waited[i],
+                               MOJO_HANDLE_SIGNAL_READABLE, i, nullptr));
+    }
+    MojoTimeTicks add_elapsed = MojoGetTimeTicksNow() - start;
+
+    // Make the handle in the middle of the set the ready one.
+    const uint32_t ready = num_handles / 2u;
+    char byte = 'x';
+    ASSERT_EQ(MOJO_RESULT_OK,
+              MojoWriteMessage(peers[ready], &byte, 1u, nullptr, 0u,
+                               MOJO_WRITE_MESSAGE_FLAG_NONE));
+    PerfRun wait_run = RunForDuration([wait_set, ready]() {
+      struct MojoWaitSetResult result;
+      uint32_t num_results = 1u;
+      uint32_t max_results = 0u;
+      return CheckOk(MojoWaitSetWait(wait_set, MOJO_DEADLINE_INDEFINITE,
+                                     &num_results, &result, &max_results)) &&
+             CheckEq(static_cast<uint64_t>(ready), result.cookie);
+    });
+
+    start = MojoGetTimeTicksNow();
+    for (uint32_t i = 0; i < num_handles; i++)
+      ASSERT_EQ(MOJO_RESULT_OK, MojoWaitSetRemove(wait_set, i));
+    MojoTimeTicks remove_elapsed = MojoGetTimeTicksNow() - start;
+
+    for (uint32_t i = 0; i < num_handles; i++) {
+      EXPECT_EQ(MOJO_RESULT_OK, MojoClose(waited[i]));
+      EXPECT_EQ(MOJO_RESULT_OK, MojoClose(peers[i]));
+    }
+    EXPECT_EQ(MOJO_RESULT_OK, MojoClose(wait_set));
+    ASSERT_TRUE(wait_run.succeeded);
+
+    char sub_test_name[32];
+    snprintf(sub_test_name, sizeof(sub_test_name), "%uHandles", num_handles);
+    mojo::test::LogPerfResult("WaitSet_AddPerHandle", sub_test_name,
+                              static_cast<double>(add_elapsed) / num_handles,
+                              "microseconds");
+    ReportMicrosecondsPerIteration("WaitSet_WaitOneReady", sub_test_name,
+                                   wait_run);
+    mojo::test::LogPerfResult(
+        "WaitSet_RemovePerHandle", sub_test_name,
+        static_cast<double>(remove_elapsed) / num_handles, "microseconds");
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace system
+}  // namespace mojo
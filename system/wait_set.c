@@ -13,6 +13,7 @@
 #include <mojo/system/wait_set.h>
 
 #include "mojo/system/mojo_export.h"
+#include "mojo/system/stats_internal.h"
 #include "mojo/system/time_utils.h"
 
 // Like |offsetof()|, but includes that data itself.
@@ -48,6 +49,7 @@ MojoCreateWaitSet(const struct MojoCreateWaitSetOptions* options,
     }
   }
   *handle = (MojoHandle)wait_set;
+  StatsAdd(MOJO_STATS_COUNTER_WAIT_SET_HANDLES_CREATED, 1u);
   return MOJO_RESULT_OK;
 }
 